@@ -0,0 +1,129 @@
+/**
+ * @file aho_automaton.h
+ * @author Maria Ławniczak (Nr Indeksu: 268544)
+ * @brief Automat Aho-Corasick nad alfabetem DNA, wspólny dla aho_gapped i genotype
+ * Typ danych wyjściowych (Meta) wybiera narzędzie: seed wzorca albo sonda allelu
+ * @date 2026-01-25
+ */
+
+#pragma once
+
+#include <bits/stdc++.h>
+using namespace std;
+
+/**
+ * @brief Mapowanie znaków DNA na indeksy 0..4 dla automatu
+ * Traktujemy A, C, G, T jako standard, a resztę (w tym N) jako indeks 4
+ */
+inline int char_idx(char c){
+    switch(c){
+        case 'A': return 0;
+        case 'C': return 1;
+        case 'G': return 2;
+        case 'T': return 3;
+        case 'N': return 4;
+        default: return 4;
+    }
+}
+
+/**
+ * @brief Implementacja automatu AC zoptymalizowana pod alfabet DNA
+ * Własne wyjścia stanów trzymamy w jednej tablicy (CSR): wyjścia stanu v to
+ * out_data[out_beg[v], out_beg[v+1]). Zamiast kopiować wyjścia wzdłuż linków fail,
+ * każdy stan wskazuje najbliższy stan-sufiks z własnymi wyjściami (dict) - pamięć
+ * wyjść jest proporcjonalna do liczby słów, a kolejność wywołań się nie zmienia.
+ */
+template<typename Meta>
+struct Aho {
+    vector<array<int,5>> next;
+    vector<int> fail;
+    vector<int> dict;                   // link słownikowy (0 = brak)
+    vector<uint32_t> out_beg;
+    vector<Meta> out_data;
+    vector<pair<int,Meta>> pending;  // (stan, wyjście) z add_word, do build_fail
+
+    Aho(){
+        next.push_back(array<int,5>{-1,-1,-1,-1,-1});
+        fail.push_back(0);
+    }
+
+    /** @brief Rezerwacja miejsca na stany i wyjścia (bez realokacji w trakcie budowy) */
+    void reserve(size_t states, size_t words){
+        next.reserve(states + 1);
+        fail.reserve(states + 1);
+        pending.reserve(words);
+    }
+
+    void add_word(string_view s, const Meta &meta){
+        int v = 0;
+        for(char c: s){
+            int id = char_idx(c);
+            if(next[v][id] == -1){
+                next[v][id] = next.size();
+                next.push_back(array<int,5>{-1,-1,-1,-1,-1});
+                fail.push_back(0);
+            }
+            v = next[v][id];
+        }
+        pending.push_back({v, meta});
+    }
+
+    void build_fail(){
+        size_t n = next.size();
+
+        // własne wyjścia stanów (sortowanie przez zliczanie, stabilne)
+        out_beg.assign(n + 1, 0);
+        for(const auto &p : pending) out_beg[p.first + 1]++;
+        for(size_t v=0; v<n; v++) out_beg[v+1] += out_beg[v];
+        out_data.resize(pending.size());
+        {
+            vector<uint32_t> at(out_beg.begin(), out_beg.end() - 1);
+            for(const auto &p : pending) out_data[at[p.first]++] = p.second;
+        }
+        vector<pair<int,Meta>>().swap(pending);
+
+        // BFS z kolejką w jednym wektorze
+        dict.assign(n, 0);
+        vector<int> order;
+        order.reserve(n);
+        for(int c=0; c<5; c++){
+            int v = next[0][c];
+            if(v != -1){
+                fail[v] = 0;
+                order.push_back(v);
+            } else { next[0][c] = 0; }
+        }
+        for(size_t head = 0; head < order.size(); head++){
+            int r = order[head];
+            for(int c=0; c<5; c++){
+                int u = next[r][c];
+                if(u == -1) continue;
+                order.push_back(u);
+                int v = fail[r];
+                while(next[v][c] == -1) v = fail[v];
+                fail[u] = next[v][c];
+                int f = fail[u];
+                dict[u] = out_beg[f+1] > out_beg[f] ? f : dict[f];
+            }
+        }
+    }
+
+    /** @brief Przejście ze stanu v po znaku tekstu (znak spoza ACGTN wraca do korzenia) */
+    int step(int v, char ch) const {
+        char c = toupper(ch);
+        if(c!='A' && c!='C' && c!='G' && c!='T' && c!='N') return 0;
+        int id = char_idx(c);
+        while(next[v][id] == -1) v = fail[v];
+        return next[v][id];
+    }
+
+    template<typename F>
+    void search_all(string_view text, F &&callback) const {
+        int v = 0;
+        for(int i=0; i<(int)text.size(); i++){
+            v = step(v, text[i]);
+            for(int u = v; u; u = dict[u])
+                for(uint32_t k = out_beg[u]; k < out_beg[u+1]; k++) callback(i, out_data[k]);
+        }
+    }
+};
@@ -9,6 +9,8 @@
 
 using namespace std;
 
+#include "fasta_io.h"
+
 /**
  * @brief Mapuje znaki alfabetu DNA na indeksy tablicy (0-4)
  * Obsługuje A, C, G, T oraz N (jako błąd lub nieznany nukleotyd)
@@ -32,8 +34,8 @@ int char_idx(char c) {
  * @return vector<string> Lista oczyszczonych wzorców
  */
 vector<string> load_patterns(const string& path) {
-    ifstream in(path);
-    if (!in) {
+    ifstream in;
+    if (!open_input(in, path)) {
         cerr << "Blad: Nie mozna otworzyc pliku " << path << "\n";
         exit(1);
     }
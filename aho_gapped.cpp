@@ -7,86 +7,100 @@
 
 #include <bits/stdc++.h>
 #include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 using namespace std;
 
-/**
- * @brief Mapowanie znaków DNA na indeksy 0..4 dla automatu
- * Traktujemy A, C, G, T jako standard, a resztę (w tym N) jako indeks 4
- */
-static inline int char_idx(char c){
-    switch(c){
-        case 'A': return 0;
-        case 'C': return 1;
-        case 'G': return 2;
-        case 'T': return 3;
-        case 'N': return 4;
-        default: return 4;
-    }
-}
+#include "fasta_io.h"
+#include "aho_automaton.h"
 
-/**
- * @brief Wczytywanie pliku FASTA
- * Łączymy wszystkie rekordy w jeden długi ciąg, pomijając nagłówki i białe znaki
- */
-string load_fasta(const string &path){
-    ifstream in(path);
-    if(!in){
-        cerr << "Cannot open FASTA file: " << path << "\n";
-        exit(1);
-    }
-    string line, acc, result;
-    while(getline(in, line)){
-        if(!line.empty() && line[0] == '>'){
-            if(!acc.empty()){
-                result += acc;
-                acc.clear();
-            }
-        } else{
-            for(char c: line)
-                if(!isspace((unsigned char)c))
-                    acc.push_back(toupper(c));
+/** @brief Etykiety i wagi wzorców do klasyfikacji (--classify) */
+struct PatternLabels {
+    static const uint32_t NONE = UINT32_MAX;
+    vector<string> names;            // etykieta -> nazwa
+    unordered_map<string, uint32_t> ids;
+    vector<uint32_t> of;             // wzorzec -> etykieta (NONE = wzorzec nie głosuje)
+    vector<float> weight;            // wzorzec -> wynik dodawany za każde wystąpienie
+    vector<int> primary;             // wzorzec -> seed_offset seeda, który zalicza wystąpienie
+
+    void add(const string &label, float w){
+        uint32_t id = NONE;
+        if(!label.empty()){
+            auto it = ids.try_emplace(label, names.size()).first;
+            if(it->second == names.size()) names.push_back(label);
+            id = it->second;
         }
+        of.push_back(id);
+        weight.push_back(w);
     }
-    if(!acc.empty()) result += acc;
-    return result;
-}
+};
 
 /**
  * @brief Wczytywanie wzorców tekstowych z pliku (jeden na linię)
+ * Wszystkie wzorce trafiają do jednego bufora buf; wzorzec i to buf[off[i], off[i+1]).
+ * Kolejne pliki są dopisywane za wcześniejszymi.
+ * Z lab linia to "wzorzec [etykieta [wynik]]" (wynik domyślnie 1, bez etykiety wzorzec nie głosuje).
  */
-vector<string> load_patterns(const string &path){
-    ifstream in(path);
-    if(!in){
+void load_patterns(const string &path, string &buf, vector<uint32_t> &off, PatternLabels *lab = nullptr){
+    ifstream in;
+    if(!open_input(in, path)){
         cerr << "Cannot open patterns: " << path << "\n";
         exit(1);
     }
-    string s;
-    vector<string> out;
-    while(getline(in, s)){
-        string clean;
-        for(char c: s)
-            if(!isspace((unsigned char)c))
-                clean.push_back(toupper(c));
-        if(!clean.empty())
-            out.push_back(clean);
+    string s, pat, label, score;
+    if(off.empty()) off.assign(1, 0);
+    for(size_t line_no = 1; getline(in, s); line_no++){
+        size_t before = buf.size();
+        if(lab){
+            istringstream ls(s);
+            float w = 1;
+            pat.clear(); label.clear(); score.clear();
+            ls >> pat >> label >> score;
+            // nieudany odczyt liczby dałby po cichu 0 - brak wyniku to 1, śmieci to błąd
+            if(!score.empty()){
+                char *end = nullptr;
+                w = strtof(score.c_str(), &end);
+                if(*end || !isfinite(w)){
+                    cerr << "Invalid score '" << score << "' in " << path << " line " << line_no << "\n";
+                    exit(1);
+                }
+            }
+            for(char c: pat) buf.push_back(toupper(c));
+            if(buf.size() > before) lab->add(label, w);
+        } else {
+            for(char c: s)
+                if(!isspace((unsigned char)c))
+                    buf.push_back(toupper(c));
+        }
+        if(buf.size() > before)
+            off.push_back(buf.size());
     }
-    return out;
 }
 
 /**
  * @brief Token wzorca: albo stała sekwencja (SEQ), albo przerwa (GAP)
+ * Treść SEQ jest widokiem na bufor wzorców - parsowanie niczego nie kopiuje
  */
 struct Token{
-    bool is_seq;    // true = SEQ, false = GAP
-    string seq;     // treść dla SEQ
-    int gap;        // długość dla GAP
+    bool is_seq;        // true = SEQ, false = GAP
+    string_view seq;    // treść dla SEQ
+    int gap;            // długość dla GAP
+};
+
+/** @brief Ciągły zakres tokenów jednego wzorca we wspólnej tablicy tokenów */
+struct TokenSpan {
+    const Token *b = nullptr, *e = nullptr;
+    const Token *begin() const { return b; }
+    const Token *end() const { return e; }
 };
 
 /**
  * @brief Parsowanie wzorca na tokeny (obsługa '.', '{k}' oraz ACGTN)
+ * Tokeny dopisywane są na koniec toks
  */
-vector<Token> parse_pattern(const string &p){
-    vector<Token> toks;
+void parse_pattern(string_view p, vector<Token> &toks){
     int i = 0, n = p.size();
     while(i < n){
         char c = p[i];
@@ -100,146 +114,325 @@ vector<Token> parse_pattern(const string &p){
         else if(c == '.'){
             int j = i;
             while(j<n && p[j]=='.') j++;
-            toks.push_back({false, "", j-i});
+            toks.push_back({false, {}, j-i});
             i = j;
         }
         else if(c == '{'){
             int j = i+1;
             while(j<n && p[j] != '}') j++;
             if(j<n){
-                int k = stoi(p.substr(i+1, j-(i+1)));
-                toks.push_back({false, "", k});
+                int k = 0;
+                for(int t=i+1; t<j; t++) if(isdigit((unsigned char)p[t])) k = k * 10 + (p[t] - '0');
+                toks.push_back({false, {}, k});
                 i = j+1;
             } else {
-                toks.push_back({false, "", 1});
+                toks.push_back({false, {}, 1});
                 i++;
             }
         }
         else { i++; }
     }
-    return toks;
 }
 
+/** @brief Dane wyjściowe automatu dla trafionego seeda */
+struct OutMeta {
+    int pat_id;       // który to wzorzec
+    int seed_offset;  // gdzie we wzorcu jest ten seed
+    int seed_len;     // jak długi jest ten seed
+    int panel;        // z którego pliku wzorców (PanelFile) pochodzi wzorzec
+};
+
+/**
+ * @brief Widmo k-merów tekstu z narzędzia kmer_count (plik "ACKMER01"), mapowane z dysku
+ * Służy do wyboru seedów: seed o najmniejszej szacowanej liczbie wystąpień daje
+ * najmniej kandydatów do weryfikacji
+ */
+struct KmerFreq {
+    struct Header {
+        char magic[8];
+        uint32_t k, flags;
+        uint64_t n, total, off_keys, off_counts;
+    };
+
+    const char *base = nullptr;
+    size_t size = 0;
+    const Header *h = nullptr;
+    const uint64_t *keys = nullptr;
+    const uint32_t *counts = nullptr;
+
+    void open_file(const string &path){
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat st{};
+        if(fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)){
+            cerr << "Cannot open k-mer file: " << path << "\n";
+            exit(1);
+        }
+        size = st.st_size;
+        void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if(map == MAP_FAILED){
+            cerr << "Cannot map k-mer file: " << path << "\n";
+            exit(1);
+        }
+        base = (const char*)map;
+        h = (const Header*)base;
+        if(memcmp(h->magic, "ACKMER01", 8) != 0 || h->k < 1 || h->k > 31 || h->off_counts + h->n * 4 > size){
+            cerr << "Not a k-mer file: " << path << "\n";
+            exit(1);
+        }
+        keys = (const uint64_t*)(base + h->off_keys);
+        counts = (const uint32_t*)(base + h->off_counts);
+    }
+
+    ~KmerFreq(){ if(base) munmap((void*)base, size); }
+
+    uint32_t count(uint64_t code) const {
+        const uint64_t *it = lower_bound(keys, keys + h->n, code);
+        return (it != keys + h->n && *it == code) ? counts[it - keys] : 0;
+    }
+
+    /**
+     * @brief Szacowana liczba wystąpień seeda: najrzadszy z jego k-merów (ograniczenie z góry);
+     * seed krótszy od k - średnia dla losowego tekstu. Okna z N pomijamy (N w tekście jest rzadkie).
+     */
+    double estimate(string_view seed) const {
+        int k = h->k;
+        if((int)seed.size() < k) return h->total / pow(4.0, seed.size());
+        uint64_t mask = (1ULL << (2 * k)) - 1, fw = 0, rc = 0;
+        uint32_t best = UINT32_MAX;
+        int len = 0;
+        for(char c : seed){
+            int b = char_idx(c);
+            if(b > 3){ len = 0; continue; }
+            fw = ((fw << 2) | b) & mask;
+            rc = (rc >> 2) | ((uint64_t)(3 - b) << (2 * (k - 1)));
+            if(++len >= k) best = min(best, count((h->flags & 1) ? min(fw, rc) : fw));
+        }
+        return best == UINT32_MAX ? 0 : best;
+    }
+};
+
+/** @brief Seed o znormalizowanej entropii dinukleotydów poniżej progu ma niską złożoność */
+static const double SEED_MIN_ENTROPY = 0.5;
+/** @brief ... podobnie seed o wyniku DUST (powtarzające się trójki) powyżej progu */
+static const double SEED_MAX_DUST = 1.0;
+/** @brief Najdłuższy seed zastępczy wycinany z fragmentu wzorca (krótsze - do min_seed - gdy dłuższego brak) */
+static const int SEED_WINDOW = 8;
+
+/**
+ * @brief Entropia dinukleotydów seeda podzielona przez największą możliwą dla jego długości (0..1)
+ * AAA, ATATAT, ACACAC dają wartości bliskie 0, losowe sekwencje - bliskie 1
+ */
+static double seed_entropy(string_view s){
+    if(s.size() < 3) return 1;
+    int cnt[16] = {}, n = 0;
+    for(size_t i=1; i<s.size(); i++){
+        int a = char_idx(s[i-1]), b = char_idx(s[i]);
+        if(a > 3 || b > 3) continue;
+        cnt[a * 4 + b]++;
+        n++;
+    }
+    if(n == 0) return 1;
+    double h = 0;
+    for(int c : cnt) if(c) h -= (double)c / n * log2((double)c / n);
+    return h / log2(min<size_t>(16, s.size() - 1));
+}
+
+/** @brief Wynik DUST: pary powtórzonych trójek na trójkę (0 dla sekwencji bez powtórzeń) */
+static double dust_score(string_view s){
+    if(s.size() < 4) return 0;
+    int cnt[64] = {}, n = 0;
+    double sum = 0;
+    for(size_t i=2; i<s.size(); i++){
+        int a = char_idx(s[i-2]), b = char_idx(s[i-1]), c = char_idx(s[i]);
+        if(a > 3 || b > 3 || c > 3) continue;
+        sum += cnt[a * 16 + b * 4 + c]++;
+        n++;
+    }
+    return n > 1 ? sum / (n - 1) : 0;
+}
+
+static bool low_complexity(string_view s){
+    return seed_entropy(s) < SEED_MIN_ENTROPY || dust_score(s) > SEED_MAX_DUST;
+}
+
+/** @brief Zasady wyboru seedów */
+struct SeedPolicy {
+    const KmerFreq *freq = nullptr;   // widmo k-merów tekstu: zostaje jeden, najrzadszy seed
+    bool filter_low = false;          // odrzucanie / zastępowanie seedów niskiej złożoności (--seed-filter)
+};
+
 /**
  * @brief Budowanie seedów (fragmentów SEQ o minimalnej długości)
+ * Seedy wzorca pid dopisywane są do out; zwraca liczbę dodanych.
+ * Do znalezienia wystąpienia wystarczy dowolny seed bez N, bo każde trafienie jest
+ * weryfikowane w całości - dlatego seedy niskiej złożoności (AAA, ATATAT), które w genomach
+ * powtarzalnych zgłaszają ogromną liczbę kandydatów, można odrzucić, a z widmem k-merów
+ * zostawić tylko najrzadszy. Seedów z N nie wybieramy: N we wzorcu pasuje do dowolnej
+ * zasady, a w automacie tylko do N.
  */
-vector<pair<string,int>> build_seeds(const vector<Token> &toks, int min_seed_len){
-    vector<pair<string,int>> seeds;
+size_t build_seeds(TokenSpan toks, int min_seed_len, int pid, int panel, vector<pair<string_view,OutMeta>> &out,
+                   const SeedPolicy &pol = {}){
+    size_t added = 0, first = out.size();
     int offset = 0;
     for(const auto &tk: toks){
         if(tk.is_seq){
             if((int)tk.seq.size() >= min_seed_len){
-                seeds.emplace_back(tk.seq, offset);
+                out.push_back({tk.seq, {pid, offset, (int)tk.seq.size(), panel}});
+                added++;
             }
             offset += tk.seq.size();
         }
         else { offset += tk.gap; }
     }
-    return seeds;
+    auto exact = [](string_view s){ return s.find('N') == string_view::npos; };
+
+    // Filtr zmienia tylko seedy bez N o niskiej złożoności - zbiór trafień zostaje ten sam.
+    // Odrzucamy je, jeśli zostaje dobry seed bez N; gdy takiego nie ma, zastępujemy je
+    // najdłuższym oknem bez N (od SEED_WINDOW w dół do min_seed), a spośród równie długich -
+    // oknem o najwyższej entropii. Seedów z N nie ruszamy: dokładne okno w ich miejscu
+    // znajdowałoby trafienia, których bez filtra żaden silnik nie zgłasza.
+    auto weak = [&](string_view s){ return exact(s) && low_complexity(s); };
+    if(pol.filter_low && any_of(out.begin() + first, out.end(), [&](const auto &e){ return weak(e.first); })){
+        bool any_good = false;
+        for(size_t i = first; i < out.size(); i++)
+            if(exact(out[i].first) && !low_complexity(out[i].first)) any_good = true;
+        pair<string_view,OutMeta> best;
+        int best_len = 0;
+        if(!any_good){
+            double best_score = -1;
+            offset = 0;
+            for(const auto &tk: toks){
+                if(!tk.is_seq){ offset += tk.gap; continue; }
+                int top = min<int>(tk.seq.size(), max(min_seed_len, SEED_WINDOW));
+                for(int len = top; len >= max(min_seed_len, best_len) && len > 0; len--){
+                    for(int b = 0; b + len <= (int)tk.seq.size(); b++){
+                        string_view w = tk.seq.substr(b, len);
+                        if(!exact(w) || low_complexity(w)) continue;
+                        double sc = seed_entropy(w);
+                        if(len > best_len || sc > best_score){
+                            best_len = len;
+                            best_score = sc;
+                            best = {w, {pid, offset + b, len, panel}};
+                        }
+                    }
+                    if(best_len == len) break;  // krótsze okna tego fragmentu są gorsze
+                }
+                offset += tk.seq.size();
+            }
+        }
+        // bez dobrego zastępstwa zostawiamy seedy jak są
+        if(any_good || best_len > 0){
+            size_t w = first;
+            for(size_t i = first; i < out.size(); i++)
+                if(!weak(out[i].first)) out[w++] = out[i];
+            out.resize(w);
+            if(best_len > 0) out.push_back(best);
+        }
+        added = out.size() - first;
+    }
+
+    if(pol.freq && added > 1){
+        size_t best = SIZE_MAX;
+        double best_est = 0;
+        for(size_t i = first; i < out.size(); i++){
+            if(out[i].first.find('N') != string_view::npos) continue;
+            double est = pol.freq->estimate(out[i].first);
+            if(best == SIZE_MAX || est < best_est){ best = i; best_est = est; }
+        }
+        if(best != SIZE_MAX){
+            out[first] = out[best];
+            out.resize(first + 1);
+            added = 1;
+        }
+    }
+    return added;
 }
 
-/** @brief Dane wyjściowe automatu dla trafionego seeda */
-struct OutMeta {
-    int pat_id;       // który to wzorzec
-    int seed_offset;  // gdzie we wzorcu jest ten seed
-    int seed_len;     // jak długi jest ten seed
-};
+/**
+ * @brief Zwarty zapis wzorców do weryfikacji: rekordy w jednym buforze słów 64-bitowych
+ * Rekord wzorca: nagłówek (długość całkowita << 32 | liczba odcinków), dla każdego
+ * odcinka ACGT słowo (przesunięcie we wzorcu << 32 | długość), a dalej zasady odcinków
+ * po 2 bity (każdy odcinek od nowego słowa). Przerwy i 'N' nie zajmują miejsca - to po
+ * prostu luki między odcinkami. Typowy wzorzec mieści się w jednej-dwóch liniach cache,
+ * a rekordy zawierają tylko przesunięcia, więc bufor można zapisać bez przeliczania.
+ */
+struct PackedPatterns {
+    vector<uint64_t> words;
+    vector<uint32_t> rec;   // początek rekordu wzorca i (w słowach)
+    // odcinki ACGT bieżącego wzorca: (przesunięcie, początek w tokenie SEQ, długość);
+    // bufor roboczy add() - czyszczony, nie alokowany na każdy wzorzec
+    vector<tuple<uint32_t, const char*, uint32_t>> runs;
 
-/** @brief Implementacja automatu AC zoptymalizowana pod alfabet DNA */
-struct Aho {
-    vector<array<int,5>> next;
-    vector<int> fail;
-    vector<vector<OutMeta>> out;
-
-    Aho(){
-        next.push_back(array<int,5>{-1,-1,-1,-1,-1});
-        fail.push_back(0);
-        out.emplace_back();
-    }
-
-    void add_word(const string &s, const OutMeta &meta){
-        int v = 0;
-        for(char c: s){
-            int id = char_idx(c);
-            if(next[v][id] == -1){
-                next[v][id] = next.size();
-                next.push_back(array<int,5>{-1,-1,-1,-1,-1});
-                fail.push_back(0);
-                out.emplace_back();
+    /** @brief Kod 2-bitowy znaku tekstu (także małe litery), -1 dla pozostałych */
+    static int code(char c){
+        static const auto lut = []{
+            array<int8_t,256> t;
+            t.fill(-1);
+            t['A'] = t['a'] = 0; t['C'] = t['c'] = 1;
+            t['G'] = t['g'] = 2; t['T'] = t['t'] = 3;
+            return t;
+        }();
+        return lut[(unsigned char)c];
+    }
+
+    /** @brief Dopisanie wzorca w postaci tokenów */
+    void add(TokenSpan toks){
+        rec.push_back(words.size());
+        runs.clear();
+        uint32_t off = 0;
+        for(const auto &tk : toks){
+            if(!tk.is_seq){ off += tk.gap; continue; }
+            for(size_t i=0; i<tk.seq.size(); ){
+                if(tk.seq[i] == 'N'){ i++; continue; }
+                size_t j = i;
+                while(j < tk.seq.size() && tk.seq[j] != 'N') j++;
+                runs.emplace_back(off + i, tk.seq.data() + i, j - i);
+                i = j;
             }
-            v = next[v][id];
-        }
-        out[v].push_back(meta);
-    }
-
-    void build_fail(){
-        queue<int> q;
-        for(int c=0; c<5; c++){
-            int v = next[0][c];
-            if(v != -1){
-                fail[v] = 0;
-                q.push(v);
-            } else { next[0][c] = 0; }
-        }
-        while(!q.empty()){
-            int r = q.front(); q.pop();
-            for(int c=0; c<5; c++){
-                int u = next[r][c];
-                if(u == -1) continue;
-                q.push(u);
-                int v = fail[r];
-                while(next[v][c] == -1) v = fail[v];
-                fail[u] = next[v][c];
-                for(const auto &m: out[fail[u]]) out[u].push_back(m);
+            off += tk.seq.size();
+        }
+        words.push_back((uint64_t)off << 32 | runs.size());
+        for(const auto &r : runs) words.push_back((uint64_t)get<0>(r) << 32 | get<2>(r));
+        for(const auto &r : runs){
+            const char *b = get<1>(r);
+            for(uint32_t k=0; k<get<2>(r); k += 32){
+                uint64_t w = 0;
+                for(uint32_t j=0; j<32 && k + j < get<2>(r); j++) w |= (uint64_t)code(b[k+j]) << (2*j);
+                words.push_back(w);
             }
         }
     }
 
-    template<typename F>
-    void search_all(const string &text, F &&callback){
-        int v = 0;
-        for(int i=0; i<(int)text.size(); i++){
-            char c = toupper(text[i]);
-            if(c!='A' && c!='C' && c!='G' && c!='T' && c!='N'){
-                v = 0; continue;
+    uint32_t length(int i) const { return words[rec[i]] >> 32; }
+
+    /** @brief Czy wzorzec i pasuje do tekstu od pozycji start */
+    bool match(string_view text, long start, int i) const {
+        const uint64_t *r = words.data() + rec[i];
+        uint32_t plen = r[0] >> 32, nruns = (uint32_t)r[0];
+        if(start < 0 || (size_t)start + plen > text.size()) return false;
+        const uint64_t *data = r + 1 + nruns;
+        for(uint32_t k=0; k<nruns; k++){
+            const char *t = text.data() + start + (r[1+k] >> 32);
+            uint32_t len = (uint32_t)r[1+k];
+            for(uint32_t b=0; b<len; b += 32, data++){
+                uint64_t w = *data;
+                for(uint32_t j=0; j<32 && b + j < len; j++, w >>= 2)
+                    if(code(t[b+j]) != (int)(w & 3)) return false;
             }
-            int id = char_idx(c);
-            while(next[v][id] == -1) v = fail[v];
-            v = next[v][id];
-            for(const auto &m: out[v]) callback(i, m);
         }
+        return true;
     }
 };
 
-/** @brief Sumowanie długości wszystkich tokenów we wzorcu */
-int total_pattern_length(const vector<Token> &toks){
-    int sum = 0;
-    for(const auto &tk: toks) sum += tk.is_seq ? tk.seq.size() : tk.gap;
-    return sum;
-}
-
 /**
- * @brief Weryfikacja naiwna całego wzorca w tekście po trafieniu seeda
+ * @brief Weryfikacja całego wzorca w tekście po trafieniu seeda (na zwartym zapisie)
  */
-bool verify_pattern_at(const string &text, int seed_end, int seed_offset, int seed_len, const vector<Token> &toks)
+bool verify_pattern_at(string_view text, int seed_end, int seed_offset, int seed_len,
+                       const PackedPatterns &pk, int pat_id)
 {
-    int start = seed_end - (seed_len - 1) - seed_offset;
-    if(start < 0) return false;
-    int plen = total_pattern_length(toks);
-    if(start + plen > (int)text.size()) return false;
-
-    int tpos = start;
-    for(const auto &tk: toks){
-        if(tk.is_seq){
-            for(int i=0; i<(int)tk.seq.size(); i++){
-                char tc = toupper(text[tpos+i]), pc = tk.seq[i];
-                if(pc == 'N') continue;
-                if(tc != pc) return false;
-            }
-            tpos += tk.seq.size();
-        } else { tpos += tk.gap; }
-    }
-    return true;
+    long start = (long)seed_end - (seed_len - 1) - seed_offset;
+    return pk.match(text, start, pat_id);
 }
 
 /** @brief Funkcja pomocnicza do pomiaru zużycia pamięci */
@@ -253,69 +446,1256 @@ long get_rss_kb(){
 #endif
 }
 
-int main(int argc, char **argv){
-    if(argc < 3){
-        cerr << "Usage: " << argv[0] << " <fasta> <patterns.txt> [min_seed_len]\n";
+/** @brief Plik wzorców w panelu łączonym: własny min_seed i własny plik trafień */
+struct PanelFile {
+    string path;
+    int min_seed = 3;
+    string hits_path;       // pusty = bez zapisu trafień
+    uint32_t first = 0;     // globalny identyfikator pierwszego wzorca z pliku
+};
+
+/**
+ * @brief Skompilowany zestaw wzorców: zwarty zapis do weryfikacji i automat seedów
+ * Wzorce leżą w jednym buforze (do wypisywania), seedy są widokami na niego,
+ * a weryfikacja czyta tylko rekordy PackedPatterns.
+ * Kilka plików wzorców dzieli jeden automat, więc wszystkie są przeszukiwane jednym
+ * przebiegiem; wzorce pliku k mają identyfikatory [files[k].first, files[k+1].first).
+ */
+struct Panel {
+    string pat_buf;               // wszystkie wzorce, jeden za drugim
+    vector<uint32_t> pat_off;     // wzorzec i to pat_buf[pat_off[i], pat_off[i+1])
+    PackedPatterns packed;
+    vector<pair<string_view,OutMeta>> seeds;  // seedy dodane do automatu
+    Aho<OutMeta> ac;
+    vector<PanelFile> files;
+    PatternLabels labels;         // tylko w trybie --classify
+    uint32_t cand_budget = 0;     // --cand-budget (0 = bez limitu)
+    vector<char> out_exact;       // wyjście automatu -> seed bez N (tylko z budżetem)
+
+    size_t size() const { return pat_off.empty() ? 0 : pat_off.size() - 1; }
+    /** @brief Numer pliku, z którego pochodzi wzorzec pid */
+    int file_of(uint32_t pid) const {
+        auto it = upper_bound(files.begin(), files.end(), pid, [](uint32_t p, const PanelFile &f){ return p < f.first; });
+        return it - files.begin() - 1;
+    }
+    uint32_t file_end(int k) const { return k + 1 < (int)files.size() ? files[k+1].first : size(); }
+    bool any_hits() const {
+        for(const auto &f : files) if(!f.hits_path.empty()) return true;
+        return false;
+    }
+    string_view pattern(int i) const { return string_view(pat_buf).substr(pat_off[i], pat_off[i+1] - pat_off[i]); }
+    uint32_t length(int i) const { return packed.length(i); }
+};
+
+/** @brief Dołączenie pliku wzorców do panelu (przed build_panel); with_labels - kolumny etykiety i wyniku */
+void add_panel_file(Panel &pn, PanelFile f, bool with_labels = false){
+    f.first = pn.size();
+    load_patterns(f.path, pn.pat_buf, pn.pat_off, with_labels ? &pn.labels : nullptr);
+    pn.files.push_back(move(f));
+}
+
+/** @brief Parsowanie wzorców i budowa automatu AC z ich seedów (min_seed osobno dla każdego pliku) */
+void build_panel(Panel &pn, const SeedPolicy &pol = {}){
+    int count = pn.size();
+    // tokeny są potrzebne tylko w trakcie budowy - jeden bufor dla wszystkich wzorców
+    vector<Token> toks;
+    pn.packed.rec.reserve(count);
+    pn.packed.words.reserve(count * 4);
+    for(int f=0; f<(int)pn.files.size(); f++){
+        int min_seed = pn.files[f].min_seed;
+        for(int pid = pn.files[f].first; pid < (int)pn.file_end(f); pid++){
+            toks.clear();
+            parse_pattern(pn.pattern(pid), toks);
+            TokenSpan ts{toks.data(), toks.data() + toks.size()};
+            pn.packed.add(ts);
+            if(build_seeds(ts, min_seed, pid, f, pn.seeds, pol) == 0){
+                // jeśli wzorzec jest za krótki na min_seed, weź cokolwiek
+                for(const auto &tk : ts)
+                    if(tk.is_seq && !tk.seq.empty()){
+                        pn.seeds.push_back({tk.seq, {pid, 0, (int)tk.seq.size(), f}});
+                        break;
+                    }
+            }
+        }
+    }
+
+    size_t seed_chars = 0;
+    for(const auto &s : pn.seeds) seed_chars += s.first.size();
+    pn.ac.reserve(seed_chars, pn.seeds.size());
+    for(const auto &s : pn.seeds) pn.ac.add_word(s.first, s.second);
+    pn.ac.build_fail();
+
+    // seedy z N pasują w automacie tylko do N - nie zastępują innych seedów przy wyciszaniu
+    if(pn.cand_budget){
+        unordered_set<uint64_t> with_n;
+        for(const auto &s : pn.seeds)
+            if(s.first.find('N') != string_view::npos)
+                with_n.insert((uint64_t)s.second.pat_id << 32 | (uint32_t)s.second.seed_offset);
+        pn.out_exact.resize(pn.ac.out_data.size());
+        for(size_t k=0; k<pn.out_exact.size(); k++){
+            const OutMeta &m = pn.ac.out_data[k];
+            pn.out_exact[k] = !with_n.count((uint64_t)m.pat_id << 32 | (uint32_t)m.seed_offset);
+        }
+    }
+
+    // każde wystąpienie potwierdza każdy seed wzorca - do wyniku liczymy jeden: pierwszy seed
+    // bez N (seed z N trafia w automacie tylko w literę N tekstu, więc mógłby nigdy nie zadziałać)
+    if(!pn.labels.of.empty()){
+        pn.labels.primary.assign(count, -1);
+        vector<char> primary_exact(count, 0);
+        for(const auto &s : pn.seeds){
+            int pid = s.second.pat_id;
+            bool ex = s.first.find('N') == string_view::npos;
+            if(pn.labels.primary[pid] < 0 || (ex && !primary_exact[pid])){
+                pn.labels.primary[pid] = s.second.seed_offset;
+                primary_exact[pid] = ex;
+            }
+        }
+    }
+}
+
+/** @brief Podsumowanie wyszukiwania w jednym genomie */
+struct GenomeSummary {
+    string name;
+    size_t length = 0;
+    size_t total_hits = 0;
+    size_t patterns_hit = 0;  // liczba wzorców z co najmniej jednym trafieniem
+    double search_t = 0;
+    size_t muted = 0;         // seedy wyciszone przez budżet kandydatów
+    vector<size_t> file_hits, file_patterns_hit;  // to samo w podziale na pliki wzorców
+
+    void count(const Panel &pn, vector<char> &seen, uint32_t pat_id, int file){
+        if(file_hits.empty()){
+            file_hits.assign(pn.files.size(), 0);
+            file_patterns_hit.assign(pn.files.size(), 0);
+        }
+        total_hits++;
+        file_hits[file]++;
+        if(!seen[pat_id]){ seen[pat_id] = 1; patterns_hit++; file_patterns_hit[file]++; }
+    }
+};
+
+/** @brief Zwarty zapis trafienia (8 bajtów) zbierany w pętli wyszukiwania */
+struct Hit {
+    uint32_t start;   // początek okna wzorca w tekście
+    uint32_t pat_id;  // który to wzorzec
+};
+
+/**
+ * @brief Budżet kandydatów w czasie skanu (--cand-budget N)
+ * Seed, który zgłosił już N kandydatów swojego wzorca (np. seed trafiający w powtórzenia
+ * genomu), jest wyciszany, o ile wzorzec ma inny aktywny seed bez N. Każde wystąpienie
+ * zawiera wszystkie seedy wzorca, więc pozostały seed znajdzie je wszystkie: plik --hits
+ * i liczba trafionych wzorców się nie zmieniają. Total matches liczy jednak zgłoszenia
+ * każdego seeda osobno (to samo wystąpienie kilka razy), więc maleje o zgłoszenia wyciszonych
+ * seedów. Ostatni seed bez N wzorca nigdy nie jest wyciszany.
+ */
+struct CandidateBudget {
+    static const uint32_t MUTED = UINT32_MAX;
+    uint32_t limit;
+    vector<uint32_t> used;     // wyjście automatu (indeks w out_data) -> liczba kandydatów
+    vector<uint32_t> active;   // wzorzec -> liczba aktywnych seedów bez N
+    size_t muted = 0;
+
+    explicit CandidateBudget(const Panel &pn) : limit(pn.cand_budget) {
+        if(!limit) return;
+        used.assign(pn.ac.out_data.size(), 0);
+        active.assign(pn.size(), 0);
+        for(size_t k=0; k<used.size(); k++)
+            if(pn.out_exact[k]) active[pn.ac.out_data[k].pat_id]++;
+    }
+
+    bool enabled() const { return limit > 0; }
+
+    /** @brief Czy weryfikować kandydata z wyjścia k; false - seed wyciszony */
+    bool allow(const Panel &pn, uint32_t k){
+        uint32_t &u = used[k];
+        if(u == MUTED) return false;
+        if(u < limit){ u++; return true; }
+        uint32_t pid = pn.ac.out_data[k].pat_id;
+        bool ex = pn.out_exact[k];
+        if(active[pid] <= (ex ? 1u : 0u)) return true;
+        if(ex) active[pid]--;
+        u = MUTED;
+        muted++;
+        return false;
+    }
+};
+
+/**
+ * @brief Leniwe przeglądanie zweryfikowanych trafień (pull API zamiast wywołań zwrotnych)
+ * Odpowiednik search_generator z aho_gapped.py bez korutyn C++20: kursor pamięta stan
+ * automatu, pozycję w tekście i miejsce na liście wyjść (łańcuch dict), więc next()
+ * wznawia skan dokładnie tam, gdzie się zatrzymał. Nic nie alokuje na trafienie;
+ * odbiorca sam decyduje, kiedy pobrać kolejne (next / next_batch), a skan stoi
+ * w miejscu, dopóki nie zostanie wznowiony. Tak jak scan_genome, to samo wystąpienie
+ * wzorca może zostać zgłoszone przez każdy jego seed.
+ * Tekst można też podawać porcjami (feed): stan automatu przechodzi między nimi,
+ * a next_seed zwraca niezweryfikowane seedy dla skanu strumieniowego.
+ */
+class MatchCursor {
+public:
+    MatchCursor(const Panel &pn, string_view text, CandidateBudget *budget = nullptr)
+        : pn_(pn), text_(text), budget_(budget) {}
+
+    /**
+     * @brief Kolejna porcja: text to znaki od pozycji base, obejmujące position() i dalsze
+     * (wcześniejsze znaki - historia do weryfikacji - są po stronie wywołującego)
+     */
+    void feed(string_view text, long base){
+        text_ = text;
+        base_ = base;
+    }
+
+    /** @brief Wznowienie skanu ze stanem automatu state po przeczytaniu pos znaków */
+    void resume(int state, long pos){
+        state_ = state;
+        pos_ = pos;
+        u_ = 0;
+    }
+
+    /**
+     * @brief Kolejny seed dopasowany w automacie i przepuszczony przez budżet, bez weryfikacji;
+     * kończy się na pozycji position() - 1. false, gdy podany tekst się skończył.
+     */
+    bool next_seed(const OutMeta *&m){
+        const Aho<OutMeta> &ac = pn_.ac;
+        for(;;){
+            while(u_){
+                for(uint32_t e = ac.out_beg[u_ + 1]; k_ < e; ){
+                    uint32_t k = k_++;
+                    if(budget_ && !budget_->allow(pn_, k)) continue;
+                    m = &ac.out_data[k];
+                    return true;
+                }
+                u_ = ac.dict[u_];
+                k_ = ac.out_beg[u_];
+            }
+            if(pos_ >= base_ + (long)text_.size()) return false;
+            state_ = ac.step(state_, text_[pos_++ - base_]);
+            u_ = state_;
+            k_ = ac.out_beg[u_];
+        }
+    }
+
+    /** @brief Kolejne trafienie; false, gdy tekst się skończył (tylko tekst podany w całości) */
+    bool next(Hit &out){
+        for(const OutMeta *m; next_seed(m); ){
+            int endpos = pos_ - 1;
+            if(verify_pattern_at(text_, endpos, m->seed_offset, m->seed_len, pn_.packed, m->pat_id)){
+                out = {(uint32_t)(endpos - (m->seed_len - 1) - m->seed_offset), (uint32_t)m->pat_id};
+                last_ = m;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** @brief Do cap kolejnych trafień naraz (bufor odbiorcy); zwraca liczbę zapisanych */
+    size_t next_batch(Hit *buf, size_t cap){
+        size_t n = 0;
+        while(n < cap && next(buf[n])) n++;
+        return n;
+    }
+
+    /** @brief Liczba przeczytanych znaków tekstu (postęp skanu) */
+    long position() const { return pos_; }
+
+    /** @brief Stan automatu po ostatnim przeczytanym znaku (punkt kontrolny) */
+    int state() const { return state_; }
+
+    /** @brief Seed, który zgłosił ostatnie trafienie (m.in. jego plik wzorców) */
+    const OutMeta &meta() const { return *last_; }
+
+private:
+    const Panel &pn_;
+    string_view text_;
+    CandidateBudget *budget_;
+    long base_ = 0;      // pozycja text_[0] w całym tekście (porcje)
+    long pos_ = 0;       // następny znak do przeczytania
+    int state_ = 0;      // stan automatu po znaku pos_ - 1
+    int u_ = 0;          // stan na łańcuchu dict, którego wyjścia przeglądamy
+    uint32_t k_ = 0;     // następne wyjście stanu u_
+    const OutMeta *last_ = nullptr;
+};
+
+/**
+ * @brief Przeszukanie jednego tekstu skompilowanym panelem
+ * Automat jest tylko czytany, więc wiele wątków może go współdzielić.
+ * Jeśli podano `hits`, trafienia są do niego dopisywane w zwartej postaci.
+ */
+GenomeSummary scan_genome(const Panel &pn, string_view text, vector<Hit> *hits = nullptr){
+    GenomeSummary sum;
+    vector<char> seen(pn.size(), 0);
+    auto t0 = chrono::high_resolution_clock::now();
+
+    CandidateBudget budget(pn);
+    MatchCursor cur(pn, text, budget.enabled() ? &budget : nullptr);
+    for(Hit h; cur.next(h); ){
+        sum.count(pn, seen, h.pat_id, cur.meta().panel);
+        if(hits) hits->push_back(h);
+    }
+    sum.muted = budget.muted;
+
+    auto t1 = chrono::high_resolution_clock::now();
+    sum.length = text.size();
+    sum.search_t = chrono::duration<double>(t1 - t0).count();
+    return sum;
+}
+
+/**
+ * @brief Indeks FM zbudowany narzędziem fm_index, mapowany z dysku
+ * Kody symboli: '$' = 0, A C G T = 1..4, N = 5, pozostałe = 6 (jak fm_code w fm_index.cpp)
+ */
+struct FmIndex {
+    struct Header {
+        char magic[8];
+        uint64_t n, sample, C[8];
+        uint64_t off_text, off_bwt, off_occ, off_mark, off_rank, off_sa;
+        uint64_t text_hash;
+    };
+
+    const char *base = nullptr;
+    size_t size = 0;
+    const Header *h = nullptr;
+    const uint8_t *bwt = nullptr;
+    const uint32_t *occ = nullptr, *rank = nullptr, *sa = nullptr;
+    const uint64_t *mark = nullptr;
+
+    /** @brief Kod symbolu seeda; 0 dla znaków spoza ACGTN, których automat nie dopasowuje */
+    static uint8_t code(char c){
+        switch(c){
+            case 'A': return 1;
+            case 'C': return 2;
+            case 'G': return 3;
+            case 'T': return 4;
+            case 'N': return 5;
+            default: return 0;
+        }
+    }
+
+    void open_file(const string &path){
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat st{};
+        if(fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)){
+            cerr << "Cannot open index file: " << path << "\n";
+            exit(1);
+        }
+        size = st.st_size;
+        void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if(map == MAP_FAILED){
+            cerr << "Cannot map index file: " << path << "\n";
+            exit(1);
+        }
+        base = (const char*)map;
+        h = (const Header*)base;
+        if(memcmp(h->magic, "ACFMIDX1", 8) != 0 || h->off_sa > size){
+            cerr << "Not an FM index file: " << path << "\n";
+            exit(1);
+        }
+        bwt = (const uint8_t*)(base + h->off_bwt);
+        occ = (const uint32_t*)(base + h->off_occ);
+        mark = (const uint64_t*)(base + h->off_mark);
+        rank = (const uint32_t*)(base + h->off_rank);
+        sa = (const uint32_t*)(base + h->off_sa);
+    }
+
+    ~FmIndex(){ if(base) munmap((void*)base, size); }
+
+    string_view text() const { return string_view(base + h->off_text, h->n); }
+
+    /** @brief Liczba wystąpień symbolu c w BWT[0, i) */
+    uint64_t occ_at(uint8_t c, uint64_t i) const {
+        uint64_t r = occ[(i >> 6) * 8 + c];
+        for(uint64_t k = i & ~uint64_t(63); k < i; k++) r += bwt[k] == c;
+        return r;
+    }
+
+    /** @brief Pozycja w tekście dla wiersza macierzy BWT (cofanie LF do próbki) */
+    uint64_t locate(uint64_t row) const {
+        uint64_t steps = 0;
+        while(!((mark[row >> 6] >> (row & 63)) & 1)){
+            uint8_t c = bwt[row];
+            row = h->C[c] + occ_at(c, row);
+            steps++;
+        }
+        uint64_t w = row >> 6;
+        uint64_t idx = rank[w] + __builtin_popcountll(mark[w] & ((1ull << (row & 63)) - 1));
+        return sa[idx] + steps;
+    }
+
+    /** @brief Wyszukiwanie wsteczne: przedział wierszy [lo, hi) sufiksów zaczynających się od s */
+    pair<uint64_t,uint64_t> range(string_view s) const {
+        uint64_t lo = 0, hi = h->n + 1;
+        for(int k=(int)s.size()-1; k>=0 && lo<hi; k--){
+            uint8_t c = code(s[k]);
+            if(c == 0) return {0, 0};
+            lo = h->C[c] + occ_at(c, lo);
+            hi = h->C[c] + occ_at(c, hi);
+        }
+        return {lo, hi};
+    }
+};
+
+/** @brief Względny koszt kroku LF (chybienie w cache) wobec jednego znaku skanowania automatem */
+static const uint64_t LF_COST = 16;
+
+/**
+ * @brief Wyszukiwanie przez indeks FM: seedy lokalizowane wyszukiwaniem wstecznym,
+ * potem ta sama weryfikacja co przy skanowaniu automatem.
+ * Zwraca false (nic nie robiąc), gdy szacowany koszt przekracza koszt skanowania tekstu
+ * i `force` nie jest ustawione.
+ */
+bool scan_index(const Panel &pn, const FmIndex &fm, bool force, GenomeSummary &sum, vector<Hit> *hits){
+    auto t0 = chrono::high_resolution_clock::now();
+    string_view text = fm.text();
+
+    vector<pair<uint64_t,uint64_t>> ranges(pn.seeds.size());
+    for(size_t k=0; k<pn.seeds.size(); k++) ranges[k] = fm.range(pn.seeds[k].first);
+    auto cands = [&](size_t k){ return ranges[k].second - ranges[k].first; };
+
+    // --cand-budget: liczbę kandydatów seeda znamy przed lokalizacją, więc seed z ponad N
+    // kandydatami pomijamy od razu (najpierw najczęstsze), o ile wzorzec zachowuje inny seed
+    // bez N - tak jak CandidateBudget przy skanie plik trafień się nie zmienia
+    vector<char> muted(pn.seeds.size(), 0);
+    size_t muted_count = 0;
+    if(pn.cand_budget){
+        auto exact = [&](size_t k){ return pn.seeds[k].first.find('N') == string_view::npos; };
+        vector<uint32_t> active(pn.size(), 0);
+        vector<size_t> order;
+        for(size_t k=0; k<pn.seeds.size(); k++){
+            if(exact(k)) active[pn.seeds[k].second.pat_id]++;
+            if(cands(k) > pn.cand_budget) order.push_back(k);
+        }
+        stable_sort(order.begin(), order.end(), [&](size_t x, size_t y){ return cands(x) > cands(y); });
+        for(size_t k : order){
+            uint32_t &act = active[pn.seeds[k].second.pat_id];
+            if(act <= (exact(k) ? 1u : 0u)) continue;
+            if(exact(k)) act--;
+            muted[k] = 1;
+            muted_count++;
+        }
+    }
+
+    uint64_t cost = 0;
+    for(size_t k=0; k<pn.seeds.size(); k++)
+        if(!muted[k]) cost += pn.seeds[k].first.size() * LF_COST + cands(k) * fm.h->sample * LF_COST;
+    if(!force && cost >= text.size()) return false;
+
+    vector<char> seen(pn.size(), 0);
+    for(size_t k=0; k<pn.seeds.size(); k++){
+        if(muted[k]) continue;
+        const OutMeta &m = pn.seeds[k].second;
+        for(uint64_t row = ranges[k].first; row < ranges[k].second; row++){
+            int endpos = fm.locate(row) + m.seed_len - 1;
+            if(!verify_pattern_at(text, endpos, m.seed_offset, m.seed_len, pn.packed, m.pat_id)) continue;
+            sum.count(pn, seen, m.pat_id, m.panel);
+            if(hits){
+                int start = endpos - (m.seed_len - 1) - m.seed_offset;
+                hits->push_back({(uint32_t)start, (uint32_t)m.pat_id});
+            }
+        }
+    }
+
+    auto t1 = chrono::high_resolution_clock::now();
+    sum.length = text.size();
+    sum.muted = muted_count;
+    sum.search_t = chrono::duration<double>(t1 - t0).count();
+    return true;
+}
+
+/**
+ * @brief Zapis trafień z flankami: pat_id, wzorzec, start, end, [left], match, [right]
+ * Trafienia są sortowane po pozycji, a wycinki tekstu dołączane dopiero tutaj,
+ * więc pętla wyszukiwania nie kopiuje żadnych sekwencji.
+ */
+/** @brief Porządek trafień w pliku --hits: pozycja, potem wzorzec */
+static bool hit_less(const Hit &x, const Hit &y){
+    return x.start != y.start ? x.start < y.start : x.pat_id < y.pat_id;
+}
+static bool hit_equal(const Hit &x, const Hit &y){
+    return x.start == y.start && x.pat_id == y.pat_id;
+}
+
+/**
+ * @brief Dopisanie linii trafienia do line
+ * tv zawiera tekst od pozycji tv_off (cały tekst albo okno skanu strumieniowego);
+ * musi obejmować okno wzorca z flankami. pat_id w linii to numer wzorca w jego pliku.
+ */
+static void append_hit_line(string &line, const Panel &pn, string_view tv, size_t tv_off,
+                            size_t start, uint32_t pat_id, int file, int context){
+    size_t b = start, e = b + pn.length(pat_id);
+    line += to_string(pat_id - pn.files[file].first); line += '\t';
+    line += pn.pattern(pat_id); line += '\t';
+    line += to_string(b); line += '\t';
+    line += to_string(e); line += '\t';
+    if(context > 0){
+        size_t lb = b >= (size_t)context ? b - context : 0;
+        line += tv.substr(lb - tv_off, b - lb); line += '\t';
+    }
+    line += tv.substr(b - tv_off, e - b);
+    if(context > 0){
+        line += '\t';
+        line += tv.substr(e - tv_off, context);
+    }
+    line += '\n';
+}
+
+/** @brief sinks[k] - plik trafień k-tego pliku wzorców (nullptr = trafienia pomijamy) */
+void write_hits(const vector<ostream*> &sinks, const Panel &pn, string_view tv, vector<Hit> &hits, int context){
+    sort(hits.begin(), hits.end(), hit_less);
+    // to samo wystąpienie potwierdza każdy seed wzorca - zapisujemy je raz
+    hits.erase(unique(hits.begin(), hits.end(), hit_equal), hits.end());
+
+    string line;
+    for(const auto &h : hits){
+        int f = pn.file_of(h.pat_id);
+        if(!sinks[f]) continue;
+        line.clear();
+        append_hit_line(line, pn, tv, 0, h.start, h.pat_id, f, context);
+        sinks[f]->write(line.data(), line.size());
+    }
+}
+
+/** @brief Podsumowanie w podziale na pliki wzorców (tylko przy kilku plikach) */
+void print_panel_summary(const Panel &pn, const vector<size_t> &hits, const vector<size_t> &patterns_hit){
+    if(pn.files.size() < 2) return;
+    for(size_t k=0; k<pn.files.size(); k++)
+        cout << "Panel " << k << " (" << pn.files[k].path << "): patterns " << pn.file_end(k) - pn.files[k].first
+             << ", matches " << (hits.empty() ? 0 : hits[k])
+             << ", patterns hit " << (patterns_hit.empty() ? 0 : patterns_hit[k]) << "\n";
+}
+
+/** @brief Rozmiar porcji wejścia w skanie przyrostowym (bajty pliku); po każdej punkt kontrolny */
+static const size_t SCAN_CHUNK = 16 << 20;
+
+/** @brief Kandydat / trafienie w skanie przyrostowym (pozycje 64-bitowe - wejście bez limitu) */
+struct StreamHit {
+    uint64_t start;
+    uint32_t pat_id;
+    uint32_t panel;
+    bool operator<(const StreamHit &o) const { return start != o.start ? start < o.start : pat_id < o.pat_id; }
+    bool operator==(const StreamHit &o) const { return start == o.start && pat_id == o.pat_id; }
+};
+
+/**
+ * @brief Skan przyrostowy: tekst podawany porcjami do MatchCursor, stan automatu przechodzi między nimi
+ * Trzymamy okno historii o długości najdłuższego wzorca (plus flanki), więc każdy kandydat,
+ * którego okno zaczyna się we wcześniejszej porcji, jest weryfikowany bez ponownego czytania.
+ * Kandydaci, których okno wychodzi poza wczytany tekst, czekają w pending. Potwierdzone
+ * trafienia czekają w ready, aż żadne późniejsze nie może mieć mniejszego startu, i są
+ * wypisywane w tej samej kolejności (i bez powtórzeń) co write_hits.
+ */
+struct StreamScanner {
+    const Panel &pn;
+    int context;
+    long maxlen = 1;
+    string buf;                       // tekst od pozycji base do end()
+    uint64_t base = 0;
+    vector<StreamHit> pending, ready;
+    size_t total_hits = 0, patterns_hit = 0;
+    vector<size_t> file_hits, file_patterns_hit;
+    vector<char> seen;
+    CandidateBudget budget;
+    MatchCursor cur;
+
+    StreamScanner(const Panel &p, int ctx)
+        : pn(p), context(ctx), file_hits(p.files.size(), 0), file_patterns_hit(p.files.size(), 0), seen(p.size(), 0),
+          budget(p), cur(p, {}, budget.enabled() ? &budget : nullptr) {
+        for(size_t i=0; i<pn.size(); i++) maxlen = max<long>(maxlen, pn.length(i));
+    }
+
+    uint64_t end() const { return base + buf.size(); }
+
+    /** @brief Weryfikacja kandydata z kompletnym oknem i zaliczenie trafienia */
+    void check(const StreamHit &h){
+        if(!pn.packed.match(buf, (long)(h.start - base), h.pat_id)) return;
+        total_hits++;
+        file_hits[h.panel]++;
+        if(!seen[h.pat_id]){ seen[h.pat_id] = 1; patterns_hit++; file_patterns_hit[h.panel]++; }
+        if(!pn.files[h.panel].hits_path.empty()) ready.push_back(h);
+    }
+
+    /** @brief Dopisanie n znaków tekstu i przeszukanie ich */
+    void feed(const char *s, size_t n){
+        buf.append(s, n);
+        size_t w = 0;
+        for(const StreamHit &h : pending){
+            if(h.start + pn.length(h.pat_id) <= end()) check(h);
+            else pending[w++] = h;
+        }
+        pending.resize(w);
+
+        cur.feed(buf, base);
+        for(const OutMeta *m; cur.next_seed(m); ){
+            uint64_t i = cur.position() - 1;
+            uint64_t back = (uint64_t)(m->seed_len - 1) + m->seed_offset;
+            if(i < back) continue;
+            StreamHit h{i - back, (uint32_t)m->pat_id, (uint32_t)m->panel};
+            if(h.start + pn.length(h.pat_id) <= end()) check(h);
+            else pending.push_back(h);
+        }
+    }
+
+    /**
+     * @brief Wypisanie do outs[plik] trafień, przed którymi nie pojawi się już żadne inne,
+     * i przycięcie historii. at_eof - tekst się skończył (kandydaci z niepełnym oknem odpadają).
+     */
+    void flush(vector<string> &outs, bool at_eof){
+        if(at_eof) pending.clear();
+        // przyszłe trafienia mają start >= bound (nowe seedy kończą się na pozycji >= end())
+        uint64_t bound = at_eof ? UINT64_MAX : end() + 1 - min<uint64_t>(end() + 1, maxlen);
+        for(const auto &h : pending) bound = min(bound, h.start);
+        sort(ready.begin(), ready.end());
+        ready.erase(unique(ready.begin(), ready.end()), ready.end());
+        size_t k = 0;
+        for(; k < ready.size(); k++){
+            const StreamHit &h = ready[k];
+            if(h.start >= bound) break;
+            if(!at_eof && h.start + pn.length(h.pat_id) + context > end()) break;
+            append_hit_line(outs[h.panel], pn, buf, base, h.start, h.pat_id, h.panel, context);
+        }
+        ready.erase(ready.begin(), ready.begin() + k);
+
+        // historia: najdłuższy wzorzec z flankami, oczekujący kandydaci i niewypisane trafienia
+        uint64_t keep = end() - min<uint64_t>(end(), maxlen + context);
+        for(const auto &h : pending) keep = min(keep, h.start);
+        for(const auto &h : ready) keep = min(keep, h.start - min<uint64_t>(h.start, context));
+        if(keep > base){
+            buf.erase(0, keep - base);
+            base = keep;
+        }
+    }
+};
+
+/** @brief Podpis panelu w punkcie kontrolnym (FNV-1a) - stan automatu ma sens tylko dla tego samego panelu */
+static uint64_t panel_signature(const Panel &pn){
+    uint64_t h = 1469598103934665603ULL;
+    auto mix = [&](const void *p, size_t n){
+        for(size_t i=0; i<n; i++){ h ^= ((const unsigned char*)p)[i]; h *= 1099511628211ULL; }
+    };
+    mix(pn.pat_buf.data(), pn.pat_buf.size());
+    mix(pn.pat_off.data(), pn.pat_off.size() * sizeof(uint32_t));
+    for(const auto &f : pn.files) mix(&f.min_seed, sizeof(f.min_seed));
+    mix(&pn.cand_budget, sizeof(pn.cand_budget));
+    size_t states = pn.ac.next.size(), seeds = pn.seeds.size();
+    mix(&states, sizeof(states));
+    mix(&seeds, sizeof(seeds));
+    return h;
+}
+
+/** @brief Stan skanu zapisywany w punkcie kontrolnym (poza samym skanerem) */
+struct ScanProgress {
+    uint64_t in_off = 0;    // ile bajtów wejścia zostało przetworzonych
+    vector<uint64_t> out_off;   // ile bajtów każdego pliku trafień jest zapisanych
+};
+
+/**
+ * @brief Zapis punktu kontrolnego: stan automatu, pozycja w wejściu i stan parsera,
+ * historia, oczekujący kandydaci, niewypisane trafienia, liczniki i pozycja pliku wyjściowego.
+ * Piszemy do pliku tymczasowego i podmieniamy go przez rename - plik jest zawsze spójny.
+ */
+bool save_checkpoint(const string &path, uint64_t sig, const ScanProgress &pr,
+                     const FastaParser &parser, const StreamScanner &sc){
+    string tmp = path + ".tmp";
+    ofstream out(tmp, ios::binary | ios::trunc);
+    if(!out) return false;
+    auto put = [&](const auto &v){ out.write((const char*)&v, sizeof(v)); };
+    auto put_vec = [&](const auto &v){
+        uint64_t n = v.size();
+        put(n);
+        out.write((const char*)v.data(), n * sizeof(v[0]));
+    };
+    out.write("ACCKPT02", 8);
+    put(sig); put(pr.in_off); put_vec(pr.out_off);
+    put(parser.line_start); put(parser.in_header); put(parser.invalid);
+    put(sc.base); put(sc.cur.state()); put(sc.total_hits); put(sc.patterns_hit);
+    put_vec(sc.file_hits); put_vec(sc.file_patterns_hit);
+    put_vec(sc.budget.used); put_vec(sc.budget.active); put(sc.budget.muted);
+    put_vec(sc.buf); put_vec(sc.pending); put_vec(sc.ready); put_vec(sc.seen);
+    out.close();
+    if(!out) return false;
+    return rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+/** @brief Odczyt punktu kontrolnego; false, gdy pliku nie ma albo nie pasuje do panelu */
+bool load_checkpoint(const string &path, uint64_t sig, ScanProgress &pr, FastaParser &parser, StreamScanner &sc){
+    ifstream in(path, ios::binary);
+    if(!in) return false;
+    char magic[8];
+    uint64_t file_sig = 0;
+    if(!in.read(magic, 8) || memcmp(magic, "ACCKPT02", 8) != 0 || !in.read((char*)&file_sig, 8)){
+        cerr << "Not a checkpoint file: " << path << "\n";
+        exit(1);
+    }
+    if(file_sig != sig){
+        cerr << "Checkpoint " << path << " was written for a different pattern panel\n";
+        exit(1);
+    }
+    auto get = [&](auto &v){ in.read((char*)&v, sizeof(v)); };
+    auto get_vec = [&](auto &v){
+        uint64_t n = 0;
+        get(n);
+        v.resize(n);
+        in.read((char*)v.data(), n * sizeof(v[0]));
+    };
+    get(pr.in_off); get_vec(pr.out_off);
+    get(parser.line_start); get(parser.in_header); get(parser.invalid);
+    int state = 0;
+    get(sc.base); get(state); get(sc.total_hits); get(sc.patterns_hit);
+    get_vec(sc.file_hits); get_vec(sc.file_patterns_hit);
+    get_vec(sc.budget.used); get_vec(sc.budget.active); get(sc.budget.muted);
+    get_vec(sc.buf); get_vec(sc.pending); get_vec(sc.ready); get_vec(sc.seen);
+    if(!in || sc.seen.size() != sc.pn.size() || pr.out_off.size() != sc.pn.files.size()){
+        cerr << "Truncated checkpoint file: " << path << "\n";
+        exit(1);
+    }
+    sc.cur.resume(state, sc.end());
+    return true;
+}
+
+/**
+ * @brief Skan strumieniowy porcjami (--engine stream, wejście "-" = stdin, --checkpoint)
+ * Pamięć nie zależy od długości wejścia, więc działa też dla nieograniczonych strumieni.
+ * Z ck_path po każdej porcji zapisujemy stan; jeśli plik punktu kontrolnego istnieje, wznawiamy
+ * od zapisanej pozycji bez ponownego skanowania (plik --hits przycinamy do zapisanej długości).
+ * Po udanym zakończeniu punkt kontrolny jest usuwany.
+ */
+int run_stream(const Panel &pn, const string &path, const string &ck_path, int context){
+    bool from_stdin = path == "-";
+    if(from_stdin && !ck_path.empty()){
+        cerr << "Checkpoints need a seekable input file, not stdin\n";
+        return 1;
+    }
+    int fd = from_stdin ? STDIN_FILENO : open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        cerr << "Cannot open FASTA file: " << path << "\n";
         return 1;
     }
+    uint64_t sig = panel_signature(pn);
+    FastaParser parser;
+    StreamScanner sc(pn, context);
+    ScanProgress pr;
+    pr.out_off.assign(pn.files.size(), 0);
+    bool resumed = !ck_path.empty() && load_checkpoint(ck_path, sig, pr, parser, sc);
+    if(resumed){
+        cerr << "Resuming from checkpoint: input offset " << pr.in_off << ", text position " << sc.end() << "\n";
+        if(lseek(fd, pr.in_off, SEEK_SET) < 0){
+            cerr << "Cannot seek in " << path << "\n";
+            return 1;
+        }
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // osobny plik trafień dla każdego pliku wzorców
+    vector<ofstream> hits(pn.files.size());
+    for(size_t k=0; k<pn.files.size(); k++){
+        const string &hp = pn.files[k].hits_path;
+        if(hp.empty()) continue;
+        if(resumed){
+            error_code ec;
+            filesystem::resize_file(hp, pr.out_off[k], ec);
+            if(ec){
+                cerr << "Cannot truncate hits file: " << hp << "\n";
+                return 1;
+            }
+        }
+        hits[k].open(hp, ios::binary | (resumed ? ios::app : ios::trunc));
+        if(!hits[k]){
+            cerr << "Cannot create hits file: " << hp << "\n";
+            return 1;
+        }
+    }
+    vector<string> outs(pn.files.size());
+    auto write_out = [&](){
+        for(size_t k=0; k<outs.size(); k++){
+            if(hits[k].is_open()){
+                hits[k].write(outs[k].data(), outs[k].size());
+                hits[k].flush();
+                pr.out_off[k] += outs[k].size();
+            }
+            outs[k].clear();
+        }
+    };
 
-    // Inicjalizacja i ładowanie danych
-    string fasta = argv[1], patfile = argv[2];
-    int min_seed = (argc >= 4) ? stoi(argv[3]) : 3;
     auto t0 = chrono::high_resolution_clock::now();
+    vector<char> raw(SCAN_CHUNK), txt(SCAN_CHUNK + 32);
+    for(;;){
+        ssize_t got = read(fd, raw.data(), raw.size());
+        if(got < 0){
+            cerr << "Read error in " << path << "\n";
+            return 1;
+        }
+        if(got == 0) break;
+        size_t n = parser.feed(raw.data(), got, txt.data());
+        sc.feed(txt.data(), n);
+        pr.in_off += got;
+        sc.flush(outs, false);
+        write_out();
+        if(!ck_path.empty() && !save_checkpoint(ck_path, sig, pr, parser, sc)){
+            cerr << "Cannot write checkpoint: " << ck_path << "\n";
+            return 1;
+        }
+    }
+    if(!from_stdin) close(fd);
+    sc.flush(outs, true);
+    write_out();
+    if(!ck_path.empty()) remove(ck_path.c_str());
+    auto t1 = chrono::high_resolution_clock::now();
+
+    if(parser.invalid)
+        cerr << "Warning: " << parser.invalid << " non-ACGTN characters in " << path << "\n";
+    // silnik na stderr - stdout zachowuje dotychczasowy układ podsumowania
+    cerr << "Engine: stream\n";
+    cout << "FASTA length: " << sc.end() << "\n"
+         << "Patterns count: " << pn.size() << "\n"
+         << "Search time: " << chrono::duration<double>(t1 - t0).count() << " s\n"
+         << "Total matches: " << sc.total_hits << "\n";
+    if(pn.cand_budget) cout << "Muted seeds: " << sc.budget.muted << "\n";
+    print_panel_summary(pn, sc.file_hits, sc.file_patterns_hit);
+    cout << "RSS: " << get_rss_kb() << " KB\n";
+    return 0;
+}
 
-    string text = load_fasta(fasta);
+/** @brief Rekord wejścia klasyfikacji: nazwa (pierwsze słowo nagłówka) i sekwencja */
+struct SeqRecord {
+    string name, seq;
+};
+
+/**
+ * @brief Czytnik rekordów FASTA/FASTQ (rodzaj rozpoznawany po pierwszym znaku)
+ * W odróżnieniu od load_fasta rekordy nie są łączone - każdy odczyt klasyfikujemy osobno
+ */
+struct RecordReader {
+    ifstream in;
+    bool fastq = false;
+    string header, line;  // header - nagłówek kolejnego rekordu FASTA
+
+    bool open(const string &path){
+        if(!open_input(in, path)) return false;
+        fastq = in.peek() == '@';
+        return true;
+    }
+
+    static string first_word(const string &h){
+        return h.substr(1, h.find_first_of(" \t\r", 1) - 1);
+    }
+
+    bool next(SeqRecord &r){
+        r.seq.clear();
+        if(fastq){
+            string plus, qual;
+            if(!getline(in, line) || !getline(in, r.seq) || !getline(in, plus) || !getline(in, qual)) return false;
+            r.name = first_word(line);
+            if(!r.seq.empty() && r.seq.back() == '\r') r.seq.pop_back();
+            for(char &c : r.seq) c = toupper(c);
+            return true;
+        }
+        while(header.empty()){
+            if(!getline(in, line)) return false;
+            if(!line.empty() && line[0] == '>') header = line;
+        }
+        r.name = first_word(header);
+        header.clear();
+        while(getline(in, line)){
+            if(!line.empty() && line[0] == '>'){ header = line; break; }
+            for(char c : line)
+                if(!isspace((unsigned char)c)) r.seq.push_back(toupper(c));
+        }
+        return true;
+    }
+};
+
+/** @brief Paczka rekordów klasyfikowana naraz (liczba zasad) */
+static const size_t CLASSIFY_BATCH = 64 << 20;
+
+/**
+ * @brief Klasyfikacja odczytów / okien (--classify)
+ * Każdy wzorzec ma etykietę i wynik; dla każdego rekordu (albo okna długości window
+ * w rekordzie) sumujemy wyniki etykiet jego trafień i wypisujemy tylko najlepsze etykiety
+ * (remisy rozdzielone przecinkami). Wyniki zbierane są w pętli skanu w gęstych
+ * akumulatorach wątku (wektor po etykietach + lista dotkniętych), bez listy trafień.
+ * Trafienie należy do okna, w którym się zaczyna; wzorzec może wystawać za okno.
+ */
+int run_classify(const Panel &pn, const string &path, const string &out_path, long window, int threads){
+    RecordReader rd;
+    if(!rd.open(path)){
+        cerr << "Cannot open FASTA file: " << path << "\n";
+        return 1;
+    }
+    ofstream out(out_path);
+    if(!out){
+        cerr << "Cannot create classification file: " << out_path << "\n";
+        return 1;
+    }
+    const PatternLabels &lab = pn.labels;
+    long maxlen = 1;
+    for(size_t i=0; i<pn.size(); i++) maxlen = max<long>(maxlen, pn.length(i));
+
+    struct Unit { uint32_t rec; long b, e; };
+    vector<SeqRecord> recs;
+    vector<Unit> units;
+    vector<string> lines;
+    size_t n_units = 0, classified = 0;
+    atomic<size_t> classified_batch{0};
+    auto t0 = chrono::high_resolution_clock::now();
+    out << "#name\tstart\tend\tlabels\tscore\ttotal_score\n";
+
+    auto worker = [&](atomic<size_t> &next_unit){
+        vector<double> acc(lab.names.size(), 0.0);
+        vector<size_t> stamp(lab.names.size(), SIZE_MAX);  // jednostka, w której etykieta ostatnio głosowała
+        vector<uint32_t> touched;
+        size_t hit_units = 0;
+        for(size_t k; (k = next_unit++) < units.size(); ){
+            const Unit &u = units[k];
+            string_view seq = recs[u.rec].seq;
+            long scan_end = min<long>(seq.size(), u.e + maxlen - 1);
+            MatchCursor cur(pn, seq.substr(u.b, scan_end - u.b));
+            for(Hit h; cur.next(h); ){
+                uint32_t l = lab.of[h.pat_id];
+                if(l == PatternLabels::NONE || (long)h.start >= u.e - u.b
+                   || cur.meta().seed_offset != lab.primary[h.pat_id]) continue;
+                if(stamp[l] != k){ stamp[l] = k; acc[l] = 0; touched.push_back(l); }
+                acc[l] += lab.weight[h.pat_id];
+            }
+
+            double best = 0, total = 0;
+            for(uint32_t l : touched){ total += acc[l]; best = max(best, acc[l]); }
+            string &line = lines[k];
+            line = recs[u.rec].name;
+            line += '\t'; line += to_string(u.b);
+            line += '\t'; line += to_string(u.e);
+            line += '\t';
+            if(touched.empty() || best <= 0) line += "-";
+            else {
+                sort(touched.begin(), touched.end());
+                bool first = true;
+                for(uint32_t l : touched)
+                    if(acc[l] == best){
+                        if(!first) line += ',';
+                        line += lab.names[l];
+                        first = false;
+                    }
+                hit_units++;
+            }
+            char num[64];
+            snprintf(num, sizeof(num), "\t%g\t%g\n", best, total);
+            line += num;
+            touched.clear();
+        }
+        classified_batch += hit_units;
+    };
+
+    // Paczki rekordów: wczytanie, podział na okna, równoległe liczenie, zapis w kolejności wejścia
+    threads = max(1, threads);
+    SeqRecord rec;
+    bool more = true;
+    while(more){
+        recs.clear();
+        size_t bases = 0;
+        while(bases < CLASSIFY_BATCH && (more = rd.next(rec))){
+            bases += rec.seq.size();
+            recs.push_back(move(rec));
+        }
+        if(recs.empty()) break;
+        units.clear();
+        for(uint32_t i=0; i<recs.size(); i++){
+            long len = recs[i].seq.size(), w = window > 0 ? window : max(1L, len);
+            for(long b = 0; b < len || b == 0; b += w) units.push_back({i, b, min(len, b + w)});
+        }
+        lines.assign(units.size(), string());
+        atomic<size_t> next_unit{0};
+        classified_batch = 0;
+        vector<thread> pool;
+        int nt = min<int>(threads, units.size());
+        for(int t=1; t<nt; t++) pool.emplace_back(worker, ref(next_unit));
+        worker(next_unit);
+        for(auto &th : pool) th.join();
+        for(const auto &l : lines) out.write(l.data(), l.size());
+        n_units += units.size();
+        classified += classified_batch;
+    }
     auto t1 = chrono::high_resolution_clock::now();
-    auto patterns = load_patterns(patfile);
-
-    // Przygotowanie wzorców i automatu
-    vector<vector<Token>> ptok(patterns.size());
-    vector<int> plen(patterns.size());
-    for(int i=0; i<(int)patterns.size(); i++){
-        ptok[i] = parse_pattern(patterns[i]);
-        plen[i] = total_pattern_length(ptok[i]);
-    }
-
-    Aho ac;
-    for(int pid=0; pid<(int)patterns.size(); pid++){
-        auto seeds = build_seeds(ptok[pid], min_seed);
-        if(seeds.empty()){
-            // jeśli wzorzec jest za krótki na min_seed, weź cokolwiek
-            for(const auto &tk : ptok[pid])
-                if(tk.is_seq && !tk.seq.empty()){
-                    ac.add_word(tk.seq, {pid, 0, (int)tk.seq.size()});
+
+    cerr << "Engine: classify\n";
+    cout << "Patterns count: " << pn.size() << "\n"
+         << "Labels: " << lab.names.size() << "\n"
+         << "Units: " << n_units << " (" << (window > 0 ? "window " + to_string(window) : string("per record")) << ")\n"
+         << "Classified: " << classified << "\n"
+         << "Search time: " << chrono::duration<double>(t1 - t0).count() << " s\n"
+         << "RSS: " << get_rss_kb() << " KB\n";
+    return 0;
+}
+
+/**
+ * @brief Lista genomów dla trybu wsadowego
+ * Katalog: wszystkie zwykłe pliki w nim (posortowane), "@plik": jedna ścieżka na linię.
+ * Zwraca pustą listę, jeśli argument jest zwykłym plikiem FASTA.
+ */
+vector<string> list_genomes(const string &arg){
+    vector<string> out;
+    if(!arg.empty() && arg[0] == '@'){
+        ifstream in(arg.substr(1));
+        if(!in){
+            cerr << "Cannot open genome list: " << arg.substr(1) << "\n";
+            exit(1);
+        }
+        string line;
+        while(getline(in, line)){
+            while(!line.empty() && isspace((unsigned char)line.back())) line.pop_back();
+            if(!line.empty() && line[0] != '#') out.push_back(line);
+        }
+    } else if(filesystem::is_directory(arg)){
+        for(const auto &e : filesystem::directory_iterator(arg))
+            if(e.is_regular_file()) out.push_back(e.path().string());
+        sort(out.begin(), out.end());
+    }
+    return out;
+}
+
+/**
+ * @brief Plik trafień genomu w trybie wsadowym: nazwa genomu (bez katalogu i rozszerzenia)
+ * wstawiona przed rozszerzeniem pliku --hits, np. "hits.tsv" + "dir/g1.fa" -> "hits.g1.tsv"
+ */
+string batch_hits_path(const string &hits_path, const string &genome){
+    filesystem::path p(hits_path);
+    string name = filesystem::path(genome).stem().string();
+    return (p.parent_path() / (p.stem().string() + "." + name + p.extension().string())).string();
+}
+
+/**
+ * @brief Tryb wsadowy: jeden automat, wiele genomów, ograniczona pula wątków
+ * Każdy wątek pobiera kolejny plik, wczytuje go, przeszukuje i zwalnia,
+ * więc w pamięci jest naraz co najwyżej `threads` genomów.
+ * Trafienia (--hits, --context) zapisywane są osobno dla każdego genomu (batch_hits_path).
+ */
+int run_batch(const Panel &pn, const vector<string> &genomes, int threads, int context){
+    // pliki trafień nie mogą się nadpisywać
+    if(pn.any_hits()){
+        unordered_map<string, size_t> seen;
+        for(size_t k=0; k<genomes.size(); k++){
+            auto [it, fresh] = seen.emplace(filesystem::path(genomes[k]).stem().string(), k);
+            if(!fresh){
+                cerr << "Genomes " << genomes[it->second] << " and " << genomes[k]
+                     << " would write the same hits file\n";
+                return 1;
+            }
+        }
+    }
+
+    vector<GenomeSummary> res(genomes.size());
+    atomic<size_t> next_job{0};
+    atomic<bool> failed{false};
+    auto worker = [&](){
+        for(size_t k; !failed && (k = next_job++) < genomes.size(); ){
+            string text = load_fasta(genomes[k]);
+            vector<Hit> hits;
+            vector<Hit> *hp = pn.any_hits() ? &hits : nullptr;
+            res[k] = scan_genome(pn, text, hp);
+            res[k].name = genomes[k];
+            if(!hp) continue;
+            vector<ofstream> outs(pn.files.size());
+            vector<ostream*> sinks(pn.files.size(), nullptr);
+            for(size_t f=0; f<pn.files.size(); f++){
+                if(pn.files[f].hits_path.empty()) continue;
+                string path = batch_hits_path(pn.files[f].hits_path, genomes[k]);
+                outs[f].open(path);
+                if(!outs[f]){
+                    cerr << "Cannot create hits file: " << path << "\n";
+                    failed = true;
                     break;
                 }
-        } else {
-            for(auto &s : seeds) ac.add_word(s.first, {pid, s.second, (int)s.first.size()});
+                sinks[f] = &outs[f];
+            }
+            if(!failed) write_hits(sinks, pn, text, hits, context);
         }
+    };
+
+    threads = max(1, min<int>(threads, genomes.size()));
+    vector<thread> pool;
+    for(int t=1; t<threads; t++) pool.emplace_back(worker);
+    worker();
+    for(auto &th : pool) th.join();
+    if(failed) return 1;
+
+    // Podsumowania w kolejności wejściowej
+    cout << "genome\tlength\tmatches\tpatterns_hit\tsearch_time_s\n";
+    size_t total = 0;
+    for(const auto &r : res){
+        cout << r.name << "\t" << r.length << "\t" << r.total_hits << "\t"
+             << r.patterns_hit << "\t" << r.search_t << "\n";
+        total += r.total_hits;
     }
+    cerr << "Genomes: " << genomes.size() << ", Patterns count: " << pn.size()
+         << ", Total matches: " << total << ", RSS: " << get_rss_kb() << " KB\n";
+    return 0;
+}
 
-    ac.build_fail();
-    auto t2 = chrono::high_resolution_clock::now();
+int main(int argc, char **argv){
+    // Opcje nazwane mogą wystąpić w dowolnym miejscu
+    vector<string> pos;
+    int threads = max(1u, thread::hardware_concurrency());
+    string hits_path, index_path, engine = "auto", ck_path, classify_path, kmer_path;
+    vector<string> panel_specs;
+    int context = 0;
+    long window = 0;
+    uint32_t cand_budget = 0;
+    bool seed_filter = false;
+    for(int a=1; a<argc; a++){
+        string arg = argv[a];
+        if(arg == "--threads" && a+1 < argc) threads = stoi(argv[++a]);
+        else if(arg == "--hits" && a+1 < argc) hits_path = argv[++a];
+        else if(arg == "--context" && a+1 < argc) context = stoi(argv[++a]);
+        else if(arg == "--index" && a+1 < argc) index_path = argv[++a];
+        else if(arg == "--engine" && a+1 < argc) engine = argv[++a];
+        else if(arg == "--checkpoint" && a+1 < argc) ck_path = argv[++a];
+        else if(arg == "--panel" && a+1 < argc) panel_specs.push_back(argv[++a]);
+        else if(arg == "--classify" && a+1 < argc) classify_path = argv[++a];
+        else if(arg == "--kmer-freq" && a+1 < argc) kmer_path = argv[++a];
+        else if(arg == "--cand-budget" && a+1 < argc) cand_budget = stoul(argv[++a]);
+        else if(arg == "--seed-filter") seed_filter = true;
+        else if(arg == "--window" && a+1 < argc) window = max(0L, stol(argv[++a]));
+        else pos.push_back(arg);
+    }
 
-    // Główne wyszukiwanie
-    unordered_map<int, vector<pair<int,int>>> matches;
-    size_t total_hits = 0;
-    auto t3 = chrono::high_resolution_clock::now();
+    if(engine != "auto" && engine != "scan" && engine != "index" && engine != "stream"){
+        cerr << "Unknown engine: " << engine << " (auto, scan, index or stream)\n";
+        return 1;
+    }
+    if(engine == "index" && index_path.empty()){
+        cerr << "--engine index needs --index ref.fmi\n";
+        return 1;
+    }
 
-    ac.search_all(text, [&](int endpos, const OutMeta &m){
-        if(verify_pattern_at(text, endpos, m.seed_offset, m.seed_len, ptok[m.pat_id])){
-            int start = endpos - (m.seed_len - 1) - m.seed_offset;
-            matches[m.pat_id].push_back({start, start + plen[m.pat_id]});
-            total_hits++;
+    if(pos.size() < 2 && (pos.empty() || panel_specs.empty())){
+        cerr << "Usage: " << argv[0] << " <fasta|dir|@list> <patterns.txt> [min_seed_len]"
+             << " [--threads N] [--hits out.tsv] [--context N]"
+             << " [--index ref.fmi] [--engine auto|scan|index|stream] [--checkpoint state.ckpt]"
+             << " [--panel patterns.txt[,min_seed_len[,hits.tsv]] ...]"
+             << " [--classify out.tsv [--window N]] [--kmer-freq text.kmc]"
+             << " [--cand-budget N] [--seed-filter]\n";
+        return 1;
+    }
+
+    // Inicjalizacja i ładowanie danych
+    string fasta = pos[0];
+    int min_seed = (pos.size() >= 3) ? stoi(pos[2]) : 3;
+
+    // Pliki wzorców: pozycyjny (z --hits) i kolejne --panel; wszystkie trafiają do jednego automatu
+    vector<PanelFile> files;
+    if(pos.size() >= 2) files.push_back({pos[1], min_seed, hits_path});
+    for(const string &spec : panel_specs){
+        PanelFile f;
+        f.min_seed = min_seed;
+        size_t c1 = spec.find(','), c2 = c1 == string::npos ? c1 : spec.find(',', c1 + 1);
+        f.path = spec.substr(0, c1);
+        if(c1 != string::npos && c2 != c1 + 1) f.min_seed = stoi(spec.substr(c1 + 1, c2 - c1 - 1));
+        if(c2 != string::npos) f.hits_path = spec.substr(c2 + 1);
+        files.push_back(f);
+    }
+    size_t from_stdin = fasta == "-";
+    for(const auto &f : files) from_stdin += f.path == "-";
+    if(from_stdin > 1){
+        cerr << "Only one input can be read from stdin\n";
+        return 1;
+    }
+
+    Panel pn;
+    for(const auto &f : files) add_panel_file(pn, f, !classify_path.empty());
+    // Widmo k-merów tekstu (kmer_count): po jednym, najrzadszym seedzie na wzorzec
+    KmerFreq kf;
+    SeedPolicy pol;
+    if(!kmer_path.empty()){
+        kf.open_file(kmer_path);
+        pol.freq = &kf;
+    }
+    pol.filter_low = seed_filter;
+    // klasyfikacja zalicza wystąpienie z jednego, ustalonego seeda - nie może go wyciszyć
+    pn.cand_budget = classify_path.empty() ? cand_budget : 0;
+    build_panel(pn, pol);
+    if(!kmer_path.empty())
+        cerr << "Seeds: " << pn.seeds.size() << " (rarest per pattern, k = " << kf.h->k << ")\n";
+
+    // Klasyfikacja: wzorce z etykietami i wynikami, najlepsze etykiety na odczyt / okno
+    if(!classify_path.empty())
+        return run_classify(pn, fasta, classify_path, window, threads);
+
+    // Wiele genomów: automat budujemy raz i współdzielimy między wątkami
+    vector<string> genomes = list_genomes(fasta);
+    if(!genomes.empty()){
+        // indeks i punkt kontrolny dotyczą jednego tekstu
+        if(!index_path.empty() || !ck_path.empty() || (engine != "auto" && engine != "scan")){
+            cerr << "--index, --checkpoint and --engine index|stream take a single FASTA file, not "
+                 << fasta << "\n";
+            return 1;
         }
-    });
+        return run_batch(pn, genomes, threads, context);
+    }
 
-    auto t4 = chrono::high_resolution_clock::now();
-    double search_t = chrono::duration<double>(t4 - t3).count();
+    // Długie lub nieograniczone wejście: skan porcjami z oknem historii (opcjonalnie wznawialny)
+    if(engine == "stream" || fasta == "-" || !ck_path.empty()){
+        if(!index_path.empty()){
+            cerr << "--index cannot be combined with stdin input, --checkpoint or --engine stream\n";
+            return 1;
+        }
+        return run_stream(pn, fasta, ck_path, context);
+    }
+
+    // Z indeksem tekst pochodzi z pliku indeksu; plik FASTA czytamy porcjami tylko po to,
+    // żeby sprawdzić (długość i skrót), że indeks zbudowano właśnie z niego
+    string loaded;
+    string_view text;
+    FmIndex fm;
+    if(!index_path.empty()){
+        fm.open_file(index_path);
+        text = fm.text();
+        if(!fm.h->text_hash){
+            cerr << "Index " << index_path << " has no text hash, rebuild it with fm_index\n";
+            return 1;
+        }
+        auto [len, hash] = fasta_digest(fasta);
+        if(len != fm.h->n || hash != fm.h->text_hash){
+            cerr << "FASTA file " << fasta << " does not match index " << index_path << "\n";
+            return 1;
+        }
+    } else {
+        loaded = load_fasta(fasta);
+        text = loaded;
+    }
+
+    vector<Hit> hits;
+    vector<Hit> *hp = pn.any_hits() ? &hits : nullptr;
+    GenomeSummary sum;
+    bool used_index = !index_path.empty() && engine != "scan"
+                   && scan_index(pn, fm, engine == "index", sum, hp);
+    if(!used_index) sum = scan_genome(pn, text, hp);
 
-    // Wyświetlanie wyników
+    if(hp){
+        vector<ofstream> outs(pn.files.size());
+        vector<ostream*> sinks(pn.files.size(), nullptr);
+        for(size_t k=0; k<pn.files.size(); k++){
+            const string &path = pn.files[k].hits_path;
+            if(path.empty()) continue;
+            outs[k].open(path);
+            if(!outs[k]){
+                cerr << "Cannot create hits file: " << path << "\n";
+                return 1;
+            }
+            sinks[k] = &outs[k];
+        }
+        write_hits(sinks, pn, text, hits, context);
+    }
+
+    // Wyświetlanie wyników (silnik na stderr - stdout zachowuje dotychczasowy układ)
+    cerr << "Engine: " << (used_index ? "index" : "scan") << "\n";
     cout << "FASTA length: " << text.size() << "\n"
-         << "Patterns count: " << patterns.size() << "\n"
-         << "Search time: " << search_t << " s\n"
-         << "Total matches: " << total_hits << "\n"
-         << "RSS: " << get_rss_kb() << " KB\n";
+         << "Patterns count: " << pn.size() << "\n"
+         << "Search time: " << sum.search_t << " s\n"
+         << "Total matches: " << sum.total_hits << "\n";
+    if(pn.cand_budget) cout << "Muted seeds: " << sum.muted << "\n";
+    print_panel_summary(pn, sum.file_hits, sum.file_patterns_hit);
+    cout << "RSS: " << get_rss_kb() << " KB\n";
 
     return 0;
 }
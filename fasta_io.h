@@ -0,0 +1,211 @@
+/**
+ * @file fasta_io.h
+ * @author Maria Ławniczak (Nr Indeksu: 268544)
+ * @brief Wspólne wczytywanie danych wejściowych dla wszystkich narzędzi
+ * Otwarcie pliku albo stdin ("-"), stanowy parser FASTA/FASTQ normalizujący surowe bajty
+ * i wczytanie całego pliku FASTA jako jednego ciągu
+ * @date 2026-01-25
+ */
+
+#pragma once
+
+#include <bits/stdc++.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+using namespace std;
+
+/**
+ * @brief Otwarcie pliku wejściowego; "-" oznacza standardowe wejście
+ * Potok czytany jest przez duży bufor, więc dane nie muszą trafiać do pliku tymczasowego.
+ * Bufor jest jeden na program - stdin może być tylko jednym z wejść.
+ */
+inline bool open_input(ifstream &in, const string &path){
+    static char stdin_buf[1 << 20];
+    if(path == "-"){
+        in.rdbuf()->pubsetbuf(stdin_buf, sizeof(stdin_buf));
+        in.open("/dev/stdin", ios::binary);
+    } else in.open(path);
+    return (bool)in;
+}
+
+/** @brief Deskryptor pliku wejściowego; "-" oznacza standardowe wejście (-1 przy błędzie) */
+inline int open_input_fd(const string &path){
+    return path == "-" ? STDIN_FILENO : open(path.c_str(), O_RDONLY);
+}
+
+/**
+ * @brief Stanowy parser FASTA/FASTQ normalizujący surowe bajty
+ * Pomija nagłówki i białe znaki, zamienia litery na wielkie i zlicza znaki spoza ACGTN.
+ * Bloki po 32 bajty bez białych znaków i '>' przetwarzamy wektorowo (AVX2),
+ * pozostałe bajty skalarnie. Stan (początek linii / nagłówek) przechodzi między
+ * wywołaniami feed(), więc wejście można podawać w dowolnych kawałkach.
+ * Z fastq z każdej czwórki linii bierzemy tylko sekwencję (drugą linię);
+ * z record_sep przed każdym rekordem wstawiamy ten znak (np. 'N' przerywa k-mery).
+ */
+struct FastaParser {
+    bool line_start = true;  // czy jesteśmy na początku linii
+    bool in_header = false;  // czy pomijamy linię nagłówka '>'
+    size_t invalid = 0;      // liczba znaków sekwencji spoza ACGTN
+    bool fastq = false;      // wejście FASTQ (rekord = 4 linie)
+    char record_sep = 0;     // separator rekordów w wyjściu (0 = rekordy sklejone)
+    size_t records = 0;      // liczba rozpoczętych rekordów
+    uint64_t line_no = 0;    // numer bieżącej linii (tylko FASTQ)
+
+    /** @brief Początek linii do pominięcia w całości (nagłówek, '+', jakości) */
+    bool skip_line(char c, char *dst, size_t &o){
+        bool header = fastq ? (line_no & 3) == 0 : c == '>';
+        if(!header && !(fastq && (line_no & 3) != 1)) return false;
+        if(header){
+            records++;
+            if(record_sep) dst[o++] = record_sep;
+        }
+        in_header = true;
+        line_start = false;
+        return true;
+    }
+
+    /**
+     * @brief Przetwarza n bajtów z src, zapisując sekwencję do dst
+     * dst musi mieć miejsce na n + 32 bajty (zapisy wektorowe całymi blokami)
+     * @return Liczba zapisanych znaków
+     */
+    size_t feed(const char *src, size_t n, char *dst){
+        size_t i = 0, o = 0;
+        while(i < n){
+            if(in_header){
+                const char *nl = (const char*)memchr(src + i, '\n', n - i);
+                if(!nl) return o;
+                i = nl - src + 1;
+                in_header = false;
+                line_start = true;
+                line_no++;
+                continue;
+            }
+            if(fastq && line_start && skip_line(src[i], dst, o)){ i++; continue; }
+#if defined(__AVX2__)
+            const __m256i sp = _mm256_set1_epi8(' '), gt = _mm256_set1_epi8('>');
+            const __m256i la = _mm256_set1_epi8('a'), l25 = _mm256_set1_epi8(25);
+            const __m256i bit = _mm256_set1_epi8(0x20);
+            while(i + 32 <= n){
+                __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+                // bajty <= ' ' (białe i sterujące) oraz '>' obsługujemy skalarnie
+                __m256i special = _mm256_or_si256(
+                    _mm256_cmpeq_epi8(_mm256_min_epu8(v, sp), v),
+                    _mm256_cmpeq_epi8(v, gt));
+                __m256i t = _mm256_sub_epi8(v, la);
+                __m256i lower = _mm256_cmpeq_epi8(_mm256_min_epu8(t, l25), t);
+                __m256i up = _mm256_sub_epi8(v, _mm256_and_si256(lower, bit));
+                __m256i valid = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(up, _mm256_set1_epi8('A')),
+                                    _mm256_cmpeq_epi8(up, _mm256_set1_epi8('C'))),
+                    _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(up, _mm256_set1_epi8('G')),
+                                                    _mm256_cmpeq_epi8(up, _mm256_set1_epi8('T'))),
+                                    _mm256_cmpeq_epi8(up, _mm256_set1_epi8('N'))));
+                _mm256_storeu_si256((__m256i*)(dst + o), up);
+                uint32_t smask = _mm256_movemask_epi8(special);
+                uint32_t bad = ~(uint32_t)_mm256_movemask_epi8(valid);
+                if(smask == 0){
+                    invalid += __builtin_popcount(bad);
+                    i += 32; o += 32;
+                    line_start = false;
+                    continue;
+                }
+                // prefix przed pierwszym bajtem specjalnym jest już zapisany
+                int k = __builtin_ctz(smask);
+                if(k > 0){
+                    invalid += __builtin_popcount(bad & ((1u << k) - 1));
+                    i += k; o += k;
+                    line_start = false;
+                }
+                break;
+            }
+            if(i >= n) break;
+#endif
+            char c = src[i++];
+            if(c == '\n'){ line_start = true; line_no++; continue; }
+            if(line_start && skip_line(c, dst, o)) continue;
+            line_start = false;
+            if(isspace((unsigned char)c)) continue;
+            c = toupper((unsigned char)c);
+            if(c!='A' && c!='C' && c!='G' && c!='T' && c!='N') invalid++;
+            dst[o++] = c;
+        }
+        return o;
+    }
+};
+
+/**
+ * @brief Wczytywanie pliku FASTA ("-" = stdin)
+ * Łączymy wszystkie rekordy w jeden długi ciąg, pomijając nagłówki i białe znaki.
+ * Zwykły plik jest mapowany do pamięci i parsowany blokowo do prealokowanego bufora,
+ * potok czytany jest blokami przez ten sam parser.
+ */
+inline string load_fasta(const string &path){
+    int fd = open_input_fd(path);
+    struct stat st{};
+    if(fd < 0 || fstat(fd, &st) != 0){
+        cerr << "Cannot open FASTA file: " << path << "\n";
+        exit(1);
+    }
+    FastaParser parser;
+    string result;
+    if(S_ISREG(st.st_mode)){
+        size_t size = st.st_size;
+        if(size == 0){ close(fd); return result; }
+        void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(map == MAP_FAILED){
+            cerr << "Cannot map FASTA file: " << path << "\n";
+            exit(1);
+        }
+        madvise(map, size, MADV_SEQUENTIAL);
+        result.resize(size + 32);
+        result.resize(parser.feed((const char*)map, size, &result[0]));
+        munmap(map, size);
+    } else {
+        vector<char> raw(1 << 20);
+        for(ssize_t got; (got = read(fd, raw.data(), raw.size())) > 0; ){
+            size_t o = result.size();
+            result.resize(o + got + 32);
+            result.resize(o + parser.feed(raw.data(), got, &result[o]));
+        }
+        if(fd != STDIN_FILENO) close(fd);
+    }
+
+    if(parser.invalid)
+        cerr << "Warning: " << parser.invalid << " non-ACGTN characters in " << path << "\n";
+    return result;
+}
+
+/** @brief Skrót FNV-1a kolejnych bajtów; h - wynik dla wcześniejszej części danych */
+inline uint64_t fnv1a(const char *p, size_t n, uint64_t h = 1469598103934665603ULL){
+    for(size_t i=0; i<n; i++){ h ^= (unsigned char)p[i]; h *= 1099511628211ULL; }
+    return h;
+}
+
+/**
+ * @brief Długość i skrót FNV-1a tekstu pliku FASTA bez trzymania go w pamięci
+ * Ten sam parser co w load_fasta, więc wynik odpowiada fnv1a(load_fasta(path)).
+ */
+inline pair<uint64_t,uint64_t> fasta_digest(const string &path){
+    int fd = open_input_fd(path);
+    if(fd < 0){
+        cerr << "Cannot open FASTA file: " << path << "\n";
+        exit(1);
+    }
+    FastaParser parser;
+    vector<char> raw(1 << 20), text(raw.size() + 32);
+    uint64_t n = 0, h = fnv1a(nullptr, 0);
+    for(ssize_t got; (got = read(fd, raw.data(), raw.size())) > 0; ){
+        size_t m = parser.feed(raw.data(), got, text.data());
+        h = fnv1a(text.data(), m, h);
+        n += m;
+    }
+    if(fd != STDIN_FILENO) close(fd);
+    return {n, h};
+}
@@ -0,0 +1,225 @@
+/**
+ * @file fm_index.cpp
+ * @author Maria Ławniczak (Nr Indeksu: 268544)
+ * @brief Budowa indeksu FM dla sekwencji referencyjnej
+ * Tablicę sufiksową liczymy sami albo wczytujemy z pliku narzędzia suffix_array (--sa).
+ * Indeks (tekst, BWT, tablice Occ i próbki tablicy sufiksowej) zapisywany jest
+ * w jednym pliku, który aho_gapped mapuje do pamięci (opcja --index)
+ * @date 2026-01-25
+ */
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#include "fasta_io.h"
+
+/**
+ * @brief Kod symbolu w indeksie: '$' = 0, A C G T = 1..4, N = 5, pozostałe = 6
+ * Jak w automacie: N pasuje tylko do N, a inne znaki nie należą do żadnego seeda
+ */
+static inline uint8_t fm_code(char c){
+    switch(c){
+        case 'A': return 1;
+        case 'C': return 2;
+        case 'G': return 3;
+        case 'T': return 4;
+        case 'N': return 5;
+        default: return 6;
+    }
+}
+
+/**
+ * @brief Nagłówek pliku indeksu; wszystkie sekcje wyrównane do 64 bajtów
+ * Układ musi być zgodny z FmIndex w aho_gapped.cpp
+ */
+struct FmHeader {
+    char magic[8];        // "ACFMIDX1"
+    uint64_t n;           // długość tekstu (bez '$')
+    uint64_t sample;      // próbkujemy SA dla pozycji tekstu podzielnych przez sample
+    uint64_t C[8];        // liczba symboli mniejszych od c (łącznie z '$')
+    uint64_t off_text;    // tekst (n bajtów) - do weryfikacji dopasowań
+    uint64_t off_bwt;     // BWT (n+1 bajtów, kody 0..6)
+    uint64_t off_occ;     // uint32[8] na każdy blok 64 wierszy
+    uint64_t off_mark;    // bitmapa wierszy z zapisaną próbką SA (uint64 na 64 wiersze)
+    uint64_t off_rank;    // uint32 - liczba zaznaczonych wierszy przed każdym słowem
+    uint64_t off_sa;      // uint32 - próbki SA w kolejności wierszy
+    uint64_t text_hash;   // FNV-1a tekstu (fnv1a z fasta_io.h) - sprawdzenie pliku FASTA przy --index
+};
+
+/**
+ * @brief Tablica sufiksowa metodą podwajania prefiksów z sortowaniem pozycyjnym
+ * s kończy się unikalnym, najmniejszym symbolem 0 ('$'); złożoność O(n log n)
+ */
+vector<int32_t> build_sa(const vector<uint8_t> &s){
+    int n = s.size();
+    vector<int32_t> sa(n), rk(n), tmp(n), cnt(max(256, n) + 1);
+
+    for(int i=0; i<n; i++) cnt[s[i]]++;
+    for(int i=1; i<256; i++) cnt[i] += cnt[i-1];
+    for(int i=n-1; i>=0; i--) sa[--cnt[s[i]]] = i;
+    for(int i=0; i<n; i++) rk[i] = s[i];
+    int classes = 256;
+
+    for(int k=1; ; k<<=1){
+        // porządek według drugiego klucza (rk[i+k]); sufiksy bez drugiej połowy na początku
+        int p = 0;
+        for(int i=n-k; i<n; i++) tmp[p++] = i;
+        for(int i=0; i<n; i++) if(sa[i] >= k) tmp[p++] = sa[i] - k;
+
+        // stabilne sortowanie według pierwszego klucza
+        fill(cnt.begin(), cnt.begin() + classes + 1, 0);
+        for(int i=0; i<n; i++) cnt[rk[i]]++;
+        for(int i=1; i<=classes; i++) cnt[i] += cnt[i-1];
+        for(int i=n-1; i>=0; i--) sa[--cnt[rk[tmp[i]]]] = tmp[i];
+
+        // nowe rangi
+        tmp[sa[0]] = 0;
+        classes = 1;
+        for(int i=1; i<n; i++){
+            int a = sa[i-1], b = sa[i];
+            int a2 = a + k < n ? rk[a+k] : -1, b2 = b + k < n ? rk[b+k] : -1;
+            if(rk[a] != rk[b] || a2 != b2) classes++;
+            tmp[b] = classes - 1;
+        }
+        rk.swap(tmp);
+        if(classes == n) break;
+    }
+    return sa;
+}
+
+/**
+ * @brief Wczytanie tablicy sufiksowej z pliku suffix_array (magia "ACSAIDX1")
+ * Plik zawiera SA samego tekstu; dokładamy na początek wiersz sufiksu '$' (pozycja n).
+ * text_has_other - czy tekst zawiera znaki spoza ACGTN (wtedy plik musi mieć flagę 4).
+ */
+vector<int32_t> load_sa(const string &path, uint64_t n, bool text_has_other){
+    ifstream in(path, ios::binary);
+    char magic[8];
+    uint64_t hdr[7];
+    if(!in || !in.read(magic, 8) || !in.read((char*)hdr, sizeof(hdr)) || memcmp(magic, "ACSAIDX1", 8) != 0){
+        cerr << "Not a suffix array file: " << path << "\n";
+        exit(1);
+    }
+    // hdr: n, flags, off_sa, ...
+    if(hdr[0] != n){
+        cerr << "Suffix array length " << hdr[0] << " does not match text length " << n << "\n";
+        exit(1);
+    }
+    // starsze pliki sortowały N razem z innymi znakami - porządek różni się, gdy tekst je zawiera
+    if(!(hdr[1] & 4) && text_has_other){
+        cerr << "Suffix array " << path << " uses the old N ordering; rebuild it with suffix_array\n";
+        exit(1);
+    }
+    vector<int32_t> sa(n + 1);
+    sa[0] = n;
+    in.seekg(hdr[2]);
+    if(!in.read((char*)(sa.data() + 1), n * 4)){
+        cerr << "Truncated suffix array file: " << path << "\n";
+        exit(1);
+    }
+    return sa;
+}
+
+/** @brief Dopełnienie pliku zerami do wielokrotności 64 bajtów */
+static uint64_t pad64(ofstream &out, uint64_t pos){
+    static const char zeros[64] = {};
+    uint64_t aligned = (pos + 63) & ~uint64_t(63);
+    out.write(zeros, aligned - pos);
+    return aligned;
+}
+
+int main(int argc, char **argv){
+    vector<string> pos;
+    string sa_path;
+    for(int a=1; a<argc; a++){
+        string arg = argv[a];
+        if(arg == "--sa" && a+1 < argc) sa_path = argv[++a];
+        else pos.push_back(arg);
+    }
+    if(pos.size() < 2){
+        cerr << "Usage: " << argv[0] << " <fasta> <out.fmi> [sa_sample] [--sa ref.sa]\n";
+        return 1;
+    }
+
+    string fasta = pos[0], outpath = pos[1];
+    uint64_t sample = (pos.size() >= 3) ? stoull(pos[2]) : 32;
+    if(sample == 0) sample = 1;
+
+    auto t0 = chrono::high_resolution_clock::now();
+    string text = load_fasta(fasta);
+    uint64_t n = text.size();
+    if(n + 1 >= (uint64_t)INT32_MAX){
+        cerr << "Text too long for 32-bit index: " << n << "\n";
+        return 1;
+    }
+
+    vector<uint8_t> s(n + 1);
+    for(uint64_t i=0; i<n; i++) s[i] = fm_code(text[i]);
+    s[n] = 0;
+
+    vector<int32_t> sa = sa_path.empty() ? build_sa(s) : load_sa(sa_path, n, count(s.begin(), s.end(), 6) > 0);
+    auto t1 = chrono::high_resolution_clock::now();
+
+    // BWT oraz tablice pomocnicze
+    uint64_t rows = n + 1;
+    uint64_t blocks = rows / 64 + 1, words = (rows + 63) / 64;
+    vector<uint8_t> bwt(rows);
+    vector<uint32_t> occ(blocks * 8, 0);
+    vector<uint64_t> mark(words, 0);
+    vector<uint32_t> rank(words, 0);
+    vector<uint32_t> samples;
+
+    array<uint32_t,8> run{};
+    for(uint64_t r=0; r<rows; r++){
+        if(r % 64 == 0) copy(run.begin(), run.end(), occ.begin() + (r/64) * 8);
+        bwt[r] = sa[r] == 0 ? 0 : s[sa[r] - 1];
+        run[bwt[r]]++;
+        if(sa[r] % sample == 0){
+            mark[r/64] |= 1ull << (r%64);
+            samples.push_back(sa[r]);
+        }
+    }
+    if(rows % 64 == 0) copy(run.begin(), run.end(), occ.begin() + (rows/64) * 8);
+    for(uint64_t w=1; w<words; w++) rank[w] = rank[w-1] + __builtin_popcountll(mark[w-1]);
+
+    FmHeader h{};
+    memcpy(h.magic, "ACFMIDX1", 8);
+    h.n = n;
+    h.sample = sample;
+    h.text_hash = fnv1a(text.data(), n);
+    array<uint64_t,8> freq{};
+    for(uint8_t c : s) freq[c]++;
+    for(int c=1; c<8; c++) h.C[c] = h.C[c-1] + freq[c-1];
+
+    ofstream out(outpath, ios::binary);
+    if(!out){
+        cerr << "Cannot create index file: " << outpath << "\n";
+        return 1;
+    }
+    out.write((const char*)&h, sizeof(h));
+    uint64_t fpos = pad64(out, sizeof(h));
+
+    auto section = [&](uint64_t &off, const void *data, uint64_t bytes){
+        off = fpos;
+        out.write((const char*)data, bytes);
+        fpos = pad64(out, fpos + bytes);
+    };
+    section(h.off_text, text.data(), n);
+    section(h.off_bwt, bwt.data(), rows);
+    section(h.off_occ, occ.data(), occ.size() * 4);
+    section(h.off_mark, mark.data(), mark.size() * 8);
+    section(h.off_rank, rank.data(), rank.size() * 4);
+    section(h.off_sa, samples.data(), samples.size() * 4);
+
+    // nagłówek z uzupełnionymi przesunięciami
+    out.seekp(0);
+    out.write((const char*)&h, sizeof(h));
+    out.close();
+
+    auto t2 = chrono::high_resolution_clock::now();
+    cerr << "[OK] Saved " << outpath << " (Text: " << n << ", SA samples: " << samples.size()
+         << ", Size: " << fpos << " B)\n"
+         << "SA time: " << chrono::duration<double>(t1 - t0).count() << " s, "
+         << "Total time: " << chrono::duration<double>(t2 - t0).count() << " s\n";
+    return 0;
+}
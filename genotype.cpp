@@ -0,0 +1,263 @@
+/**
+ * @file genotype.cpp
+ * @author Maria Ławniczak (Nr Indeksu: 268544)
+ * @brief Genotypowanie znanych wariantów jednym przebiegiem automatu Aho-Corasick
+ * Z referencji i listy wariantów (format zbliżony do VCF) budujemy sondy alleli REF i ALT
+ * z flankami, ładujemy je do jednego automatu i zliczamy ich wystąpienia w próbce
+ * (złożenie FASTA albo odczyty FASTQ)
+ * @date 2026-01-25
+ */
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#include "fasta_io.h"
+#include "aho_automaton.h"
+
+/** @brief Referencja: połączone rekordy oraz zakres [start[r], start[r+1]) każdego rekordu */
+struct RefGenome {
+    string seq;
+    unordered_map<string, size_t> index;   // nazwa rekordu (pierwsze słowo nagłówka) -> numer
+    vector<size_t> start;                  // początek rekordu r; na końcu długość seq
+
+    size_t records() const { return start.size() - 1; }
+};
+
+/**
+ * @brief Wczytywanie referencji FASTA
+ * Łączymy rekordy w jeden ciąg, zapamiętując, gdzie zaczyna się każdy z nich
+ */
+RefGenome load_reference(const string &path){
+    ifstream in;
+    if(!open_input(in, path)){
+        cerr << "Cannot open FASTA file: " << path << "\n";
+        exit(1);
+    }
+    RefGenome g;
+    string line;
+    while(getline(in, line)){
+        if(!line.empty() && line[0] == '>'){
+            string name = line.substr(1, line.find_first_of(" \t\r", 1) - 1);
+            g.index[name] = g.start.size();
+            g.start.push_back(g.seq.size());
+            continue;
+        }
+        for(char c: line)
+            if(!isspace((unsigned char)c))
+                g.seq.push_back(toupper(c));
+    }
+    if(g.start.empty()) g.start.push_back(0);  // sekwencja bez nagłówka - jeden rekord
+    g.start.push_back(g.seq.size());
+    return g;
+}
+
+/** @brief Wariant: pozycja (0-based w połączonej referencji), allele REF i ALT */
+struct Variant {
+    string chrom, id, ref;
+    long pos;              // pozycja 1-based z pliku
+    long gpos;             // pozycja 0-based w połączonej referencji
+    long rec_b, rec_e;     // zakres rekordu CHROM w połączonej referencji (flanki nie wychodzą poza niego)
+    vector<string> alts;
+};
+
+/**
+ * @brief Wczytywanie wariantów: CHROM POS ID REF ALT[,ALT...] (dalsze kolumny ignorowane)
+ * Linie zaczynające się od '#' pomijamy. Jeśli CHROM nie jest nazwą rekordu, a referencja
+ * ma jeden rekord, pozycja liczona jest od jego początku. Warianty wychodzące poza koniec
+ * rekordu odrzucamy z osobnym ostrzeżeniem.
+ */
+vector<Variant> load_variants(const string &path, const RefGenome &g){
+    ifstream in;
+    if(!open_input(in, path)){
+        cerr << "Cannot open variants: " << path << "\n";
+        exit(1);
+    }
+    vector<Variant> out;
+    string line;
+    size_t skipped = 0, out_of_range = 0;
+    while(getline(in, line)){
+        if(line.empty() || line[0] == '#') continue;
+        istringstream ls(line);
+        Variant v;
+        string alts;
+        if(!(ls >> v.chrom >> v.pos >> v.id >> v.ref >> alts)){ skipped++; continue; }
+        for(char &c : v.ref) c = toupper(c);
+        for(char &c : alts) c = toupper(c);
+        for(size_t b = 0; b <= alts.size(); ){
+            size_t e = alts.find(',', b);
+            if(e == string::npos) e = alts.size();
+            v.alts.push_back(alts.substr(b, e - b));
+            b = e + 1;
+        }
+
+        auto it = g.index.find(v.chrom);
+        if(it == g.index.end() && g.records() > 1){ skipped++; continue; }
+        size_t r = it == g.index.end() ? 0 : it->second;
+        v.rec_b = g.start[r];
+        v.rec_e = g.start[r + 1];
+        if(v.pos < 1 || v.pos - 1 + (long)v.ref.size() > v.rec_e - v.rec_b){ out_of_range++; continue; }
+        v.gpos = v.rec_b + v.pos - 1;
+        if(g.seq.compare(v.gpos, v.ref.size(), v.ref) != 0){
+            skipped++;
+            continue;
+        }
+        out.push_back(move(v));
+    }
+    if(out_of_range) cerr << "Warning: skipped " << out_of_range << " variants with POS beyond the end of CHROM\n";
+    if(skipped) cerr << "Warning: skipped " << skipped << " variants (bad line, unknown CHROM or REF mismatch)\n";
+    return out;
+}
+
+/** @brief Dopełnienie odwrotne sekwencji DNA */
+string revcomp(const string &s){
+    string r(s.rbegin(), s.rend());
+    for(char &c : r){
+        switch(c){
+            case 'A': c = 'T'; break;
+            case 'C': c = 'G'; break;
+            case 'G': c = 'C'; break;
+            case 'T': c = 'A'; break;
+            default: c = 'N';
+        }
+    }
+    return r;
+}
+
+/** @brief Dane wyjściowe automatu dla trafionej sondy */
+struct OutMeta {
+    int var_id;   // który wariant
+    int allele;   // 0 = REF, 1.. = kolejne ALT
+};
+
+/**
+ * @brief Budowa sond: flanka + allel + flanka, dla obu nici (flanki przycięte do rekordu wariantu)
+ * Sondy identyczne dla dwóch alleli tego samego wariantu nie rozróżniają ich - pomijamy je.
+ * Zwraca liczbę dodanych sond.
+ */
+size_t build_probes(Aho<OutMeta> &ac, const RefGenome &g, const vector<Variant> &vars, int flank){
+    size_t probes = 0;
+    for(int vid=0; vid<(int)vars.size(); vid++){
+        const Variant &v = vars[vid];
+        long lb = max(v.rec_b, v.gpos - flank);
+        long re = min(v.rec_e, v.gpos + (long)v.ref.size() + flank);
+        string left = g.seq.substr(lb, v.gpos - lb);
+        string right = g.seq.substr(v.gpos + v.ref.size(), re - v.gpos - v.ref.size());
+
+        vector<string> alleles{v.ref};
+        alleles.insert(alleles.end(), v.alts.begin(), v.alts.end());
+        vector<string> seqs;
+        for(const auto &al : alleles) seqs.push_back(left + (al == "-" || al == "*" ? "" : al) + right);
+
+        for(int a=0; a<(int)seqs.size(); a++){
+            if(count(seqs.begin(), seqs.end(), seqs[a]) > 1) continue;
+            ac.add_word(seqs[a], {vid, a});
+            string rc = revcomp(seqs[a]);
+            if(rc != seqs[a]) ac.add_word(rc, {vid, a});
+            probes++;
+        }
+    }
+    ac.build_fail();
+    return probes;
+}
+
+/**
+ * @brief Przetwarzanie próbki rekord po rekordzie (FASTA lub FASTQ)
+ * Każda sekwencja przeszukiwana jest osobno, więc sondy nie łączą się przez granice rekordów
+ */
+template<typename F>
+void for_each_sequence(const string &path, F &&f){
+    ifstream in;
+    if(!open_input(in, path)){
+        cerr << "Cannot open sample: " << path << "\n";
+        exit(1);
+    }
+    string line, seq;
+    int c = in.peek();
+    if(c == '@'){
+        // FASTQ: nagłówek, sekwencja, '+', jakości
+        string plus, qual;
+        while(getline(in, line) && getline(in, seq) && getline(in, plus) && getline(in, qual)){
+            for(char &x : seq) x = toupper(x);
+            f(seq);
+        }
+        return;
+    }
+    while(getline(in, line)){
+        if(!line.empty() && line[0] == '>'){
+            if(!seq.empty()) f(seq);
+            seq.clear();
+            continue;
+        }
+        for(char x : line)
+            if(!isspace((unsigned char)x))
+                seq.push_back(toupper(x));
+    }
+    if(!seq.empty()) f(seq);
+}
+
+/**
+ * @brief Genotyp z liczby trafień alleli
+ * Allel dominujący powyżej 80% - homozygota, inaczej dwa najczęstsze allele; "./." bez pokrycia
+ */
+string call_genotype(const vector<uint32_t> &cnt, uint32_t min_depth){
+    uint32_t total = accumulate(cnt.begin(), cnt.end(), 0u);
+    if(total == 0 || total < min_depth) return "./.";
+    vector<int> order(cnt.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&](int x, int y){ return cnt[x] > cnt[y]; });
+    int a = order[0];
+    if(cnt.size() < 2 || cnt[order[1]] == 0 || cnt[a] * 5 > total * 4) return to_string(a) + "/" + to_string(a);
+    int b = order[1];
+    return to_string(min(a, b)) + "/" + to_string(max(a, b));
+}
+
+int main(int argc, char **argv){
+    if(argc < 4){
+        cerr << "Usage: " << argv[0] << " <reference.fasta> <variants.vcf> <sample.fasta|fastq> [flank] [min_depth]\n";
+        return 1;
+    }
+
+    if(count(argv + 1, argv + 4, string("-")) > 1){
+        cerr << "Only one input can be read from stdin\n";
+        return 1;
+    }
+
+    int flank = (argc >= 5) ? stoi(argv[4]) : 15;
+    uint32_t min_depth = (argc >= 6) ? stoul(argv[5]) : 1;
+
+    auto t0 = chrono::high_resolution_clock::now();
+    RefGenome g = load_reference(argv[1]);
+    vector<Variant> vars = load_variants(argv[2], g);
+
+    Aho<OutMeta> ac;
+    size_t probes = build_probes(ac, g, vars, flank);
+    string().swap(g.seq);  // referencja nie jest już potrzebna
+    auto t1 = chrono::high_resolution_clock::now();
+
+    // Jeden przebieg po próbce genotypuje wszystkie warianty naraz
+    vector<vector<uint32_t>> counts(vars.size());
+    for(size_t k=0; k<vars.size(); k++) counts[k].assign(vars[k].alts.size() + 1, 0);
+    size_t sequences = 0, bases = 0;
+    for_each_sequence(argv[3], [&](const string &seq){
+        sequences++;
+        bases += seq.size();
+        ac.search_all(seq, [&](int, const OutMeta &m){ counts[m.var_id][m.allele]++; });
+    });
+    auto t2 = chrono::high_resolution_clock::now();
+
+    cout << "#CHROM\tPOS\tID\tREF\tALT\tREF_COUNT\tALT_COUNTS\tGT\n";
+    for(size_t k=0; k<vars.size(); k++){
+        const Variant &v = vars[k];
+        cout << v.chrom << "\t" << v.pos << "\t" << v.id << "\t" << v.ref << "\t";
+        for(size_t a=0; a<v.alts.size(); a++) cout << (a ? "," : "") << v.alts[a];
+        cout << "\t" << counts[k][0] << "\t";
+        for(size_t a=1; a<counts[k].size(); a++) cout << (a > 1 ? "," : "") << counts[k][a];
+        cout << "\t" << call_genotype(counts[k], min_depth) << "\n";
+    }
+
+    cerr << "Variants: " << vars.size() << ", Probes: " << probes << ", Automaton states: " << ac.next.size() << "\n"
+         << "Sample sequences: " << sequences << ", Bases: " << bases << "\n"
+         << "Build time: " << chrono::duration<double>(t1 - t0).count() << " s, "
+         << "Scan time: " << chrono::duration<double>(t2 - t1).count() << " s\n";
+    return 0;
+}
@@ -0,0 +1,361 @@
+/**
+ * @file kmer_count.cpp
+ * @author Maria Ławniczak (Nr Indeksu: 268544)
+ * @brief Widmo k-merów (k <= 31) dla FASTA/FASTQ
+ * K-mery kodujemy 2 bitami na zasadę kroczącym oknem (N i inne znaki przerywają okno).
+ * Liczenie jest podzielone na partycje według najstarszych bitów kodu: wątki rozrzucają
+ * kody do własnych kubełków partycji, potem każda partycja jest liczona przez jeden wątek
+ * we własnej tablicy mieszającej - bez blokad i operacji atomowych. Wynik zapisywany jest
+ * w zwartym pliku binarnym (posortowane kody + liczności), który aho_gapped mapuje
+ * do pamięci przy wyborze seedów (opcja --kmer-freq)
+ * @date 2026-01-25
+ */
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#include "fasta_io.h"
+
+/** @brief Kod 2-bitowy zasady (A C G T = 0..3); -1 dla N i pozostałych znaków */
+static inline int base_code(char c){
+    switch(c){
+        case 'A': case 'a': return 0;
+        case 'C': case 'c': return 1;
+        case 'G': case 'g': return 2;
+        case 'T': case 't': return 3;
+        default: return -1;
+    }
+}
+
+/**
+ * @brief Przejście po wszystkich k-merach sekwencji (kod do przodu i dopełnienia odwrotnego)
+ * Dopełnienie odwrotne liczymy tym samym oknem, więc kanoniczny k-mer nic nie kosztuje
+ */
+template<typename F>
+static void for_each_kmer(string_view s, int k, F &&f){
+    uint64_t mask = (1ULL << (2 * k)) - 1;
+    int shift = 2 * (k - 1);
+    uint64_t fw = 0, rc = 0;
+    int len = 0;
+    for(char c : s){
+        int b = base_code(c);
+        if(b < 0){ len = 0; continue; }
+        fw = ((fw << 2) | b) & mask;
+        rc = (rc >> 2) | ((uint64_t)(3 - b) << shift);
+        if(++len >= k) f(fw, rc);
+    }
+}
+
+/** @brief Mieszanie kodu k-meru (finalizator splitmix64) */
+static inline uint64_t mix64(uint64_t x){
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief Tablica mieszająca z adresowaniem otwartym: kod k-meru -> liczność
+ * Każda partycja ma własną tablicę używaną przez jeden wątek naraz.
+ * Kod EMPTY nie występuje, bo k <= 31 (kody mają najwyżej 62 bity).
+ */
+struct CountTable {
+    static const uint64_t EMPTY = ~0ULL;
+    vector<uint64_t> keys;
+    vector<uint32_t> counts;
+    size_t used = 0, mask = 0;
+
+    CountTable(){ rehash(1 << 10); }
+
+    void rehash(size_t cap){
+        vector<uint64_t> ok(cap, EMPTY);
+        vector<uint32_t> oc(cap, 0);
+        ok.swap(keys);
+        oc.swap(counts);
+        mask = cap - 1;
+        used = 0;
+        for(size_t i=0; i<ok.size(); i++){
+            if(ok[i] == EMPTY) continue;
+            size_t j = find(ok[i]);
+            keys[j] = ok[i];
+            counts[j] = oc[i];
+            used++;
+        }
+    }
+
+    size_t find(uint64_t key) const {
+        size_t i = mix64(key) & mask;
+        while(keys[i] != EMPTY && keys[i] != key) i = (i + 1) & mask;
+        return i;
+    }
+
+    /** @brief Slot klucza; z insert wstawia brakujący, bez - zwraca SIZE_MAX dla brakującego */
+    size_t slot(uint64_t key, bool insert){
+        size_t i = find(key);
+        if(keys[i] == key) return i;
+        if(!insert) return SIZE_MAX;
+        if((used + 1) * 10 > keys.size() * 7){
+            rehash(keys.size() * 2);
+            i = find(key);
+        }
+        keys[i] = key;
+        used++;
+        return i;
+    }
+
+    void add(uint64_t key, bool insert){
+        size_t i = slot(key, insert);
+        if(i != SIZE_MAX && counts[i] != UINT32_MAX) counts[i]++;
+    }
+};
+
+/** @brief Najdłuższy kawałek sekwencji w jednej jednostce pracy (zasady) */
+static const size_t FRAG_LEN = 1 << 20;
+/** @brief Liczba zasad wczytywanych w jednej paczce */
+static const size_t KMER_BATCH = 16 << 20;
+/** @brief Rozmiar bloku odczytu wejścia (bajty) */
+static const size_t READ_BLOCK = 1 << 20;
+
+/**
+ * @brief Czytnik FASTA/FASTQ dzielący wejście na kawałki do równoległego liczenia
+ * Surowe bloki normalizuje wspólny FastaParser; rekordy rozdziela separator 'N' (przerywa
+ * okno k-meru), a długie rekordy tniemy na kawałki nakładające się o k-1 zasad - każdy
+ * k-mer trafia do dokładnie jednego kawałka
+ */
+struct FragmentReader {
+    int fd = -1;
+    bool first = true, eof = false;
+    int k = 0;
+    uint64_t bases = 0;
+    FastaParser parser;
+    vector<char> raw;
+    string cur;
+
+    ~FragmentReader(){ if(fd > STDIN_FILENO) close(fd); }
+
+    bool open(const string &path, int kk){
+        k = kk;
+        fd = open_input_fd(path);
+        if(fd < 0) return false;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        parser.record_sep = 'N';
+        raw.resize(READ_BLOCK);
+        return true;
+    }
+
+    /** @brief Odcięcie pełnych kawałków do frags, z k-1 zasadami zakładki w cur */
+    void cut(vector<string> &frags, size_t &total){
+        size_t b = 0;
+        while(cur.size() - b >= FRAG_LEN){
+            frags.emplace_back(cur, b, FRAG_LEN);
+            total += FRAG_LEN;
+            b += FRAG_LEN - (k - 1);
+        }
+        cur.erase(0, b);
+    }
+
+    /** @brief Kolejna paczka kawałków; false, gdy wejście się skończyło */
+    bool next_batch(vector<string> &frags){
+        frags.clear();
+        size_t total = 0;
+        while(total < KMER_BATCH && !eof){
+            ssize_t got = read(fd, raw.data(), raw.size());
+            if(got <= 0){ eof = true; break; }
+            if(first){ parser.fastq = raw[0] == '@'; first = false; }
+            size_t o = cur.size(), recs = parser.records;
+            cur.resize(o + got + 32);
+            size_t n = parser.feed(raw.data(), got, &cur[o]);
+            cur.resize(o + n);
+            bases += n - (parser.records - recs);
+            cut(frags, total);
+        }
+        if(eof && cur.size() >= (size_t)k) frags.push_back(move(cur));
+        if(eof) cur.clear();
+        return !frags.empty();
+    }
+};
+
+/**
+ * @brief Nagłówek pliku widma; sekcje wyrównane do 64 bajtów
+ * Układ musi być zgodny z KmerFreq w aho_gapped.cpp
+ */
+struct KmerHeader {
+    char magic[8];        // "ACKMER01"
+    uint32_t k;
+    uint32_t flags;       // bit 0: k-mery kanoniczne (min z k-meru i dopełnienia odwrotnego)
+    uint64_t n;           // liczba zapisanych k-merów
+    uint64_t total;       // liczba wszystkich policzonych wystąpień
+    uint64_t off_keys;    // uint64 - kody k-merów, rosnąco
+    uint64_t off_counts;  // uint32 - liczności w tej samej kolejności
+};
+
+/** @brief Dopełnienie pliku zerami do wielokrotności 64 bajtów */
+static uint64_t pad64(ofstream &out, uint64_t pos){
+    static const char zeros[64] = {};
+    uint64_t aligned = (pos + 63) & ~uint64_t(63);
+    out.write(zeros, aligned - pos);
+    return aligned;
+}
+
+int main(int argc, char **argv){
+    vector<string> pos;
+    int threads = max(1u, thread::hardware_concurrency());
+    string panel_path;
+    bool canonical = false;
+    long min_count = -1;
+    for(int a=1; a<argc; a++){
+        string arg = argv[a];
+        if(arg == "--threads" && a+1 < argc) threads = max(1, stoi(argv[++a]));
+        else if(arg == "--panel" && a+1 < argc) panel_path = argv[++a];
+        else if(arg == "--canonical") canonical = true;
+        else if(arg == "--min-count" && a+1 < argc) min_count = stol(argv[++a]);
+        else pos.push_back(arg);
+    }
+    if(pos.size() < 2){
+        cerr << "Usage: " << argv[0] << " <fasta|fastq|-> <out.kmc> [k] [--threads N] [--canonical]"
+             << " [--panel patterns.txt] [--min-count N]\n";
+        return 1;
+    }
+    int k = (pos.size() >= 3) ? stoi(pos[2]) : 15;
+    if(k < 1 || k > 31){
+        cerr << "k must be in 1..31\n";
+        return 1;
+    }
+    // z panelem zapisujemy też k-mery bez wystąpień
+    if(min_count < 0) min_count = panel_path.empty() ? 1 : 0;
+
+    auto t0 = chrono::high_resolution_clock::now();
+
+    // Partycje według najstarszych bitów kodu: złączone po kolei dają porządek rosnący
+    int pbits = min(8, 2 * k);
+    size_t parts = size_t(1) << pbits;
+    int pshift = 2 * k - pbits;
+    vector<CountTable> tables(parts);
+
+    // Panel: liczymy tylko k-mery występujące we wzorcach (fragmenty ACGT między lukami)
+    bool only_known = !panel_path.empty();
+    size_t panel_kmers = 0;
+    if(only_known){
+        ifstream pin;
+        if(!open_input(pin, panel_path)){
+            cerr << "Cannot open patterns: " << panel_path << "\n";
+            return 1;
+        }
+        string line, pat;
+        while(getline(pin, line)){
+            istringstream ls(line);
+            if(!(ls >> pat)) continue;
+            for(char &c : pat) c = toupper(c);
+            for_each_kmer(pat, k, [&](uint64_t fw, uint64_t rc){
+                uint64_t key = canonical ? min(fw, rc) : fw;
+                tables[key >> pshift].slot(key, true);
+            });
+        }
+        for(const auto &t : tables) panel_kmers += t.used;
+    }
+
+    FragmentReader rd;
+    if(!rd.open(pos[0], k)){
+        cerr << "Cannot open FASTA file: " << pos[0] << "\n";
+        return 1;
+    }
+
+    // Kubełki [wątek][partycja]: faza 1 je wypełnia, faza 2 liczy partycje
+    vector<vector<vector<uint64_t>>> buckets(threads, vector<vector<uint64_t>>(parts));
+    vector<string> frags;
+    uint64_t total = 0;
+    while(rd.next_batch(frags)){
+        atomic<size_t> next_frag{0}, next_part{0};
+        vector<uint64_t> counted(threads, 0);
+        auto phase1 = [&](int t){
+            auto &bk = buckets[t];
+            uint64_t n = 0;
+            for(size_t i; (i = next_frag++) < frags.size(); )
+                for_each_kmer(frags[i], k, [&](uint64_t fw, uint64_t rc){
+                    uint64_t key = canonical ? min(fw, rc) : fw;
+                    bk[key >> pshift].push_back(key);
+                    n++;
+                });
+            counted[t] = n;
+        };
+        auto phase2 = [&](){
+            for(size_t p; (p = next_part++) < parts; ){
+                for(int t=0; t<threads; t++){
+                    for(uint64_t key : buckets[t][p]) tables[p].add(key, !only_known);
+                    buckets[t][p].clear();
+                }
+            }
+        };
+        {
+            vector<thread> pool;
+            for(int t=1; t<threads; t++) pool.emplace_back(phase1, t);
+            phase1(0);
+            for(auto &th : pool) th.join();
+        }
+        {
+            vector<thread> pool;
+            for(int t=1; t<threads; t++) pool.emplace_back(phase2);
+            phase2();
+            for(auto &th : pool) th.join();
+        }
+        for(uint64_t c : counted) total += c;
+    }
+    buckets.clear();
+    auto t1 = chrono::high_resolution_clock::now();
+
+    // Wynik: każda partycja posortowana osobno, partycje po kolei
+    vector<vector<pair<uint64_t,uint32_t>>> sorted(parts);
+    {
+        atomic<size_t> next_part{0};
+        auto work = [&](){
+            for(size_t p; (p = next_part++) < parts; ){
+                const CountTable &tb = tables[p];
+                auto &v = sorted[p];
+                for(size_t i=0; i<tb.keys.size(); i++)
+                    if(tb.keys[i] != CountTable::EMPTY && (long)tb.counts[i] >= min_count)
+                        v.push_back({tb.keys[i], tb.counts[i]});
+                sort(v.begin(), v.end());
+                vector<uint64_t>().swap(tables[p].keys);
+                vector<uint32_t>().swap(tables[p].counts);
+            }
+        };
+        vector<thread> pool;
+        for(int t=1; t<threads; t++) pool.emplace_back(work);
+        work();
+        for(auto &th : pool) th.join();
+    }
+
+    KmerHeader h{};
+    memcpy(h.magic, "ACKMER01", 8);
+    h.k = k;
+    h.flags = canonical ? 1 : 0;
+    h.total = total;
+    for(const auto &v : sorted) h.n += v.size();
+
+    ofstream out(pos[1], ios::binary);
+    if(!out){
+        cerr << "Cannot create output file: " << pos[1] << "\n";
+        return 1;
+    }
+    out.write((const char*)&h, sizeof(h));
+    uint64_t fpos = pad64(out, sizeof(h));
+    h.off_keys = fpos;
+    for(const auto &v : sorted)
+        for(const auto &e : v) out.write((const char*)&e.first, 8);
+    fpos = pad64(out, fpos + h.n * 8);
+    h.off_counts = fpos;
+    for(const auto &v : sorted)
+        for(const auto &e : v) out.write((const char*)&e.second, 4);
+    fpos = pad64(out, fpos + h.n * 4);
+    out.seekp(0);
+    out.write((const char*)&h, sizeof(h));
+    out.close();
+
+    auto t2 = chrono::high_resolution_clock::now();
+    cerr << "[OK] Saved " << pos[1] << " (k: " << k << (canonical ? ", canonical" : "")
+         << ", Bases: " << rd.bases << ", K-mers: " << total << ", Distinct: " << h.n;
+    if(only_known) cerr << ", Panel k-mers: " << panel_kmers;
+    cerr << ", Size: " << fpos << " B)\n"
+         << "Count time: " << chrono::duration<double>(t1 - t0).count() << " s, "
+         << "Total time: " << chrono::duration<double>(t2 - t0).count() << " s\n";
+    return 0;
+}
@@ -7,8 +7,89 @@
  */
 
 #include <bits/stdc++.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__AVX2__) || defined(__AVX512BW__)
+#include <immintrin.h>
+#endif
 using namespace std;
 
+#include "fasta_io.h"
+
+/** @brief Rozmiar bloku odczytu strumienia (1 MiB) */
+static const size_t STREAM_BLOCK = 1 << 20;
+
+/**
+ * @brief Strumień znormalizowanej sekwencji z pliku albo z surowego ciągu
+ * Plik czytany jest blokami i parsowany przez FastaParser; w buforze trzymamy tylko
+ * nieskonsumowaną końcówkę, więc pamięć jest ograniczona niezależnie od długości wejścia.
+ * Surowy ciąg (argument programu) jest czytany bez kopiowania całości.
+ */
+struct SeqStream {
+    int fd = -1;
+    string_view lit;        // surowa sekwencja, gdy argument nie jest plikiem
+    size_t lit_pos = 0;
+    FastaParser parser;
+    vector<char> raw;       // bufor odczytu z pliku
+    string buf;             // znormalizowane zasady [head, tail)
+    size_t head = 0, tail = 0;
+    long pos = 0;           // pozycja w sekwencji odpowiadająca head
+    size_t keep = 0;        // ile skonsumowanych zasad zachować przed head (historia)
+    bool eof = false;
+
+    SeqStream() = default;
+    SeqStream(const SeqStream&) = delete;
+    SeqStream &operator=(const SeqStream&) = delete;
+    ~SeqStream(){ if(fd > STDIN_FILENO) close(fd); }
+
+    /** @brief Otwarcie pliku; "-" oznacza standardowe wejście (potok) */
+    bool open_path(const string &path){
+        fd = path == "-" ? STDIN_FILENO : open(path.c_str(), O_RDONLY);
+        if(fd < 0) return false;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        raw.resize(STREAM_BLOCK);
+        return true;
+    }
+    void open_literal(string_view s){ lit = s; }
+
+    size_t avail() const { return tail - head; }
+    const char *data() const { return buf.data() + head; }
+    void consume(size_t k){ head += k; pos += k; }
+    /** @brief Historia i nieskonsumowane zasady; pierwszy znak to pozycja pos - head */
+    string_view window() const { return string_view(buf.data(), tail); }
+
+    /** @brief Dołożenie kolejnego bloku; false, gdy wejście się skończyło */
+    bool fill(){
+        if(eof) return false;
+        // przesuwamy nieskonsumowaną końcówkę (z historią) na początek bufora
+        size_t drop = head > keep ? head - keep : 0;
+        if(drop > 0 && drop >= buf.size() / 2){
+            memmove(&buf[0], buf.data() + drop, tail - drop);
+            tail -= drop;
+            head -= drop;
+        }
+        if(buf.size() < tail + STREAM_BLOCK + 32) buf.resize(tail + STREAM_BLOCK + 32);
+        if(fd >= 0){
+            ssize_t got = read(fd, raw.data(), raw.size());
+            if(got <= 0){ eof = true; return false; }
+            tail += parser.feed(raw.data(), got, &buf[tail]);
+        } else {
+            size_t k = min(STREAM_BLOCK, lit.size() - lit_pos);
+            if(k == 0){ eof = true; return false; }
+            for(size_t t=0; t<k; t++) buf[tail + t] = toupper((unsigned char)lit[lit_pos + t]);
+            lit_pos += k;
+            tail += k;
+        }
+        return true;
+    }
+
+    /** @brief Zapewnia co najmniej k dostępnych zasad (mniej tylko na końcu wejścia) */
+    size_t ensure(size_t k){
+        while(avail() < k && fill()) {}
+        return avail();
+    }
+};
+
 /**
  * @brief Funkcja wczytująca dane wejściowe
  * Obsługuje pliki (np. FASTA/TXT) oraz surowe ciągi znaków
@@ -17,117 +98,1525 @@ using namespace std;
  * @return string Oczyszczona sekwencja nukleotydowa
  */
 string load_text(const string &path){
-    ifstream in(path);
-    if(!in)
+    SeqStream in;
+    if(!in.open_path(path))
         return ""; // Zwraca pusty string, jeśli ścieżka nie jest poprawnym plikiem
 
-    string line, result;
-    while(getline(in, line)){
-        // Pomijamy nagłówki FASTA (linie zaczynające się od '>')
-        if(!line.empty() && line[0] == '>') continue; 
-        
-        for(char c: line)
-            if(!isspace((unsigned char)c))
-                result.push_back(toupper(c));
+    while(in.fill()) {}
+    in.buf.resize(in.tail);
+    return move(in.buf);
+}
+
+/** @brief Dopełnienie odwrotne sekwencji DNA (do bufora out) */
+void revcomp(string_view s, string &out){
+    out.assign(s.rbegin(), s.rend());
+    for(char &c : out){
+        switch(c){
+            case 'A': c = 'T'; break;
+            case 'C': c = 'G'; break;
+            case 'G': c = 'C'; break;
+            case 'T': c = 'A'; break;
+            default: c = 'N';
+        }
     }
-    return result;
 }
 
+/** @brief Rodzaj wykrytej różnicy */
+enum MutKind { MUT_SNP, MUT_DEL, MUT_INS, MUT_COMPLEX, MUT_DUP, MUT_INV };
+
 /**
- * @brief Algorytm porównujący sekwencje przy użyciu dwóch wskaźników
- * Wykorzystuje zachłanną heurystykę (look-ahead) do klasyfikacji zmian
- * * @param a Sekwencja referencyjna (oryginalna)
- * @param b Sekwencja zapytania (zmutowana)
- * @return vector<string> Lista opisowa wykrytych różnic
+ * @brief Pojedyncza różnica między sekwencjami
+ * pos_a / pos_b - pozycje w A i B, ref / alt - usunięte / wstawione zasady
+ */
+struct Mutation {
+    MutKind kind;
+    long pos_a, pos_b;
+    string ref, alt;
+    bool at_end = false;  // różnica w końcówce dłuższej sekwencji
+};
+
+/** @brief Minimalna długość zmiany strukturalnej (duża delecja / insercja, duplikacja, inwersja) */
+static const long SV_MIN_LEN = 50;
+
+/** @brief Opis tekstowy różnicy (format wypisywany przez program) */
+string describe(const Mutation &m){
+    switch(m.kind){
+        case MUT_SNP:
+            return "SNP at pos " + to_string(m.pos_a) + ": " + m.ref + " -> " + m.alt;
+        case MUT_DEL:
+            if(!m.at_end && (long)m.ref.size() >= SV_MIN_LEN)
+                return "Large deletion at pos " + to_string(m.pos_a) + ": removed " + to_string(m.ref.size()) + " bp";
+            return m.at_end ? "Deletion at end: removed " + m.ref
+                            : "Deletion at pos " + to_string(m.pos_a) + ": removed " + m.ref;
+        case MUT_INS:
+            if(!m.at_end && (long)m.alt.size() >= SV_MIN_LEN)
+                return "Large insertion at pos " + to_string(m.pos_a) + ": inserted " + to_string(m.alt.size()) + " bp";
+            return m.at_end ? "Insertion at end: inserted " + m.alt
+                            : "Insertion at pos " + to_string(m.pos_a) + ": inserted " + m.alt;
+        case MUT_DUP:
+            return "Tandem duplication at pos " + to_string(m.pos_a) + ": duplicated " + to_string(m.alt.size()) + " bp";
+        case MUT_INV:
+            return "Inversion at pos " + to_string(m.pos_a) + ": inverted " + to_string(m.ref.size()) + " bp";
+        default:
+            return "Complex mutation near pos A=" + to_string(m.pos_a) + " B=" + to_string(m.pos_b);
+    }
+}
+
+/**
+ * @brief Długość wspólnego prefiksu a[0..len) i b[0..len) (indeks pierwszej różnicy)
+ * Porównujemy blokami po 64/32 bajty (AVX-512/AVX2, maska + ctz), resztę słowami 8-bajtowymi,
+ * więc identyczne odcinki przechodzimy z prędkością pamięci
  */
-vector<string> compare_seqs(const string &a, const string &b){
-    vector<string> result;
+static inline size_t first_mismatch(const char *a, const char *b, size_t len){
+    size_t k = 0;
+#if defined(__AVX512BW__)
+    for(; k + 64 <= len; k += 64){
+        __m512i x = _mm512_loadu_si512((const void*)(a + k));
+        __m512i y = _mm512_loadu_si512((const void*)(b + k));
+        uint64_t ne = _mm512_cmpneq_epi8_mask(x, y);
+        if(ne) return k + __builtin_ctzll(ne);
+    }
+#endif
+#if defined(__AVX2__)
+    for(; k + 32 <= len; k += 32){
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + k));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + k));
+        uint32_t eq = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+        if(eq != 0xFFFFFFFFu) return k + __builtin_ctz(~eq);
+    }
+#endif
+    for(; k + 8 <= len; k += 8){
+        uint64_t x, y;
+        memcpy(&x, a + k, 8);
+        memcpy(&y, b + k, 8);
+        if(x != y) return k + __builtin_ctzll(x ^ y) / 8;
+    }
+    while(k < len && a[k] == b[k]) k++;
+    return k;
+}
+
+/**
+ * @brief Przesunięcie indela maksymalnie w lewo (normalizacja w obrębie powtórzenia)
+ * Delecję ref na pozycji p można przesunąć o jedną zasadę, gdy A[p-1] == A[p+len-1];
+ * insercję, gdy A[p-1] równa się ostatniej zasadzie (obróconego) allelu. Najpierw liczymy
+ * długość przesunięcia jednym przebiegiem wstecz, potem raz odtwarzamy allel - O(przesunięcie + len).
+ * @param a Okno sekwencji A; a[0] odpowiada pozycji off
+ * @param lower Najmniejsza dozwolona pozycja (koniec poprzedniego zdarzenia, nie mniej niż off)
+ */
+void left_shift(string_view a, long off, long lower, Mutation &m){
+    long p = m.pos_a, shift = 0;
+    if(m.kind == MUT_DEL){
+        long len = m.ref.size();
+        while(p - shift - 1 >= lower && a[p - shift - 1 - off] == a[p + len - shift - 1 - off]) shift++;
+        if(shift) m.ref.assign(a.substr(p - shift - off, len));
+    } else {
+        long len = m.alt.size();
+        while(p - shift - 1 >= lower && a[p - shift - 1 - off] == m.alt[((len - 1 - shift) % len + len) % len]) shift++;
+        long r = shift % len;
+        if(r) m.alt = m.alt.substr(len - r) + m.alt.substr(0, len - r);
+    }
+    m.pos_a -= shift;
+    m.pos_b -= shift;
+}
+
+/** @brief Historia sekwencji A zachowywana w trybie strumieniowym na potrzeby normalizacji */
+static const size_t NORM_HISTORY = 1 << 16;
 
+/**
+ * @brief Normalizacja indeli w locie, między detekcją a odbiorcą różnic
+ * Kolejne jednozasadowe indele tego samego typu łączymy w jedno zdarzenie, a zamknięte
+ * zdarzenie przesuwamy w lewo, najdalej do końca poprzedniej różnicy - dzięki temu ten sam
+ * indel w homopolimerze lub powtórzeniu dostaje w każdej próbce te same współrzędne,
+ * a kolejność różnic się nie zmienia. Różnice w końcówce ("at end") przechodzą bez zmian.
+ */
+struct IndelNormalizer {
+    long lower = 0;          // koniec poprzedniej różnicy w A
+    Mutation pend;
+    bool has = false;
+
+    /** @brief Wydanie oczekującego indela; a/off - okno A obejmujące [lower, koniec indela) */
+    template<typename Emit>
+    void flush(string_view a, long off, Emit &&emit){
+        if(!has) return;
+        left_shift(a, off, max(lower, off), pend);
+        lower = pend.pos_a + pend.ref.size();
+        has = false;
+        emit(move(pend));
+    }
+
+    template<typename Emit>
+    void push(Mutation m, string_view a, long off, Emit &&emit){
+        if(has && !m.at_end && m.kind == pend.kind){
+            if(m.kind == MUT_DEL && pend.pos_a + (long)pend.ref.size() == m.pos_a && pend.pos_b == m.pos_b){
+                pend.ref += m.ref;
+                return;
+            }
+            if(m.kind == MUT_INS && pend.pos_a == m.pos_a && pend.pos_b + (long)pend.alt.size() == m.pos_b){
+                pend.alt += m.alt;
+                return;
+            }
+        }
+        flush(a, off, emit);
+        if((m.kind == MUT_DEL || m.kind == MUT_INS) && !m.at_end){
+            pend = move(m);
+            has = true;
+            return;
+        }
+        lower = m.pos_a + m.ref.size();
+        emit(move(m));
+    }
+};
+
+/**
+ * @brief Algorytm porównujący fragmenty sekwencji przy użyciu dwóch wskaźników
+ * Wykorzystuje zachłanną heurystykę (look-ahead) do klasyfikacji zmian
+ * * @param a Fragment sekwencji referencyjnej (oryginalnej)
+ * @param b Fragment sekwencji zapytania (zmutowanej)
+ * @param off_a, off_b Pozycje początków fragmentów w całych sekwencjach
+ * @param last Czy fragmenty sięgają końca sekwencji (końcówki raportujemy jako "at end")
+ * @param emit Odbiorca wykrytych różnic, wywoływany w kolejności pozycji
+ */
+template<typename Emit>
+void compare_range(string_view a, string_view b, long off_a, long off_b, bool last, Emit &&emit){
     int i = 0, j = 0; // Wskaźniki pozycji: i dla sekwencji A, j dla sekwencji B
     int n = a.size(), m = b.size();
+    IndelNormalizer norm;
+    norm.lower = off_a;
+    auto put = [&](Mutation d){ norm.push(move(d), a, off_a, emit); };
 
     while(i < n && j < m){
         if(a[i] == b[j]){
-            // Znaki identyczne - przesuwamy oba wskaźniki
-            i++;
-            j++;
+            // Znaki identyczne - przeskakujemy cały identyczny odcinek naraz
+            int run = first_mismatch(a.data() + i, b.data() + j, min(n - i, m - j));
+            i += run;
+            j += run;
             continue;
         }
 
         // Analiza typu mutacji
 
         // SNP / Substytucja - jeśli znaki się różnią, ale następne w obu sekwencjach pasują do siebie
-        if(i+1 < n && j+1 < m && a[i+1] == b[j+1]){
-            result.push_back(
-                "SNP at pos " + to_string(i) +
-                ": " + a[i] + " -> " + b[j]
-            );
+        // (na końcu segmentu przed kotwicą następne zasady zgadzają się z definicji)
+        if((i+1 < n && j+1 < m && a[i+1] == b[j+1]) || (!last && i+1 == n && j+1 == m)){
+            put({MUT_SNP, off_a + i, off_b + j, string(1, a[i]), string(1, b[j])});
             i++;
             j++;
         }
 
         // Delecja (usunięcie nukleotydu w sekwencji B) - jeśli następny znak w A pasuje do obecnego w B
         else if(i+1 < n && a[i+1] == b[j]){
-            result.push_back(
-                "Deletion at pos " + to_string(i) +
-                ": removed " + a[i]
-            );
+            put({MUT_DEL, off_a + i, off_b + j, string(1, a[i]), ""});
             i++;
         }
 
         // Insercja (wstawienie nukleotydu w sekwencji B)- jeśli obecny znak w A pasuje do następnego w B
         else if(j+1 < m && a[i] == b[j+1]){
-            result.push_back(
-                "Insertion at pos " + to_string(i) +
-                ": inserted " + b[j]
-            );
+            put({MUT_INS, off_a + i, off_b + j, "", string(1, b[j])});
             j++;
         }
 
         // Zmiana złożona (Complex mutation)- jeśli prosta heurystyka zawodzi - klasyfikujemy jako zmianę grupową
         else {
-            result.push_back(
-                "Complex mutation near pos A=" +
-                to_string(i) + " B=" + to_string(j)
-            );
+            put({MUT_COMPLEX, off_a + i, off_b + j, string(1, a[i]), string(1, b[j])});
             i++;
             j++;
         }
     }
 
-    // Obsługa końcówek sekwencji - jeśli jedna sekwencja jest dłuższa od drugiej na samym końcu
+    // Obsługa końcówek - jeśli jeden fragment jest dłuższy od drugiego
     while(i < n){
-        result.push_back("Deletion at end: removed " + string(1, a[i]));
+        put({MUT_DEL, off_a + i, off_b + j, string(1, a[i]), "", last});
         i++;
     }
     while(j < m){
-        result.push_back("Insertion at end: inserted " + string(1, b[j]));
+        put({MUT_INS, off_a + i, off_b + j, "", string(1, b[j]), last});
         j++;
     }
+    norm.flush(a, off_a, emit);
+}
+
+/** @brief Spadek wyniku, po którym rozszerzanie dopasowania się zatrzymuje */
+static const long SV_XDROP = 20;
+/** @brief Segmenty od tej długości sprawdzamy pod kątem SV także przy równych długościach */
+static const long SV_SCAN_LEN = 384;
+/** @brief Dopuszczalny niewyjaśniony środek segmentu przy dużej delecji / insercji */
+static const long SV_SLACK = 16;
+
+/**
+ * @brief Rozszerzenie dopasowania bez przerw metodą X-drop: +1 za zgodność, -4 za niezgodność
+ * Zwraca długość z najlepszym wynikiem. dir = 1 - w przód od a[0], b[0] (identyczne odcinki
+ * przeskakujemy first_mismatch); dir = -1 - wstecz od a[-1], b[-1].
+ */
+static long xdrop_extend(const char *a, const char *b, long len, int dir){
+    long i = 0, score = 0, best = 0, best_i = 0;
+    while(i < len){
+        if(dir > 0){
+            long run = first_mismatch(a + i, b + i, len - i);
+            i += run;
+            score += run;
+        } else {
+            while(i < len && a[-1 - i] == b[-1 - i]){ i++; score++; }
+        }
+        if(score > best){ best = score; best_i = i; }
+        if(i >= len) break;
+        score -= 4;
+        i++;
+        if(score < best - SV_XDROP) break;
+    }
+    return best_i;
+}
+
+/**
+ * @brief Zgodność a z dopełnieniem odwrotnym b (ułamek zgodnych zasad)
+ * Sprawdzamy kilka małych przesunięć - granice inwersji znamy z dokładnością do kilku zasad
+ */
+static double revcomp_identity(string_view a, string_view b){
+    string rc;
+    revcomp(b, rc);
+    long n = min(a.size(), rc.size()), best = 0;
+    for(long sh=-4; sh<=4; sh++){
+        long eq = 0;
+        for(long i=max(0L, -sh); i<n && i + sh < (long)rc.size(); i++) eq += a[i] == rc[i + sh];
+        best = max(best, eq);
+    }
+    return n ? (double)best / n : 0;
+}
+
+/**
+ * @brief Czy insercja alt przed pozycją p całego A jest duplikacją tandemową
+ * Przesuwamy insercję maksymalnie w prawo (to samo zdarzenie, obrócony allel); duplikacja
+ * kończy się wtedy tuż przed nią, niezależnie od tego, gdzie insercję znaleziono.
+ */
+static bool is_tandem_dup(string_view a, long p, const string &alt){
+    long len = alt.size(), k = 0;
+    if(len == 0) return false;
+    while(p + k < (long)a.size() && a[p + k] == alt[k % len]) k++;
+    p += k;
+    if(p < len) return false;
+    // po k przesunięciach allel to alt obrócony o k w lewo
+    long r = k % len;
+    string_view src = a.substr(p - len, len);
+    return src.substr(0, len - r) == string_view(alt).substr(r) && src.substr(len - r) == string_view(alt).substr(0, r);
+}
+
+/**
+ * @brief Porównanie pary segmentów z wykrywaniem zmian strukturalnych
+ * Gdy długości segmentów różnią się o co najmniej SV_MIN_LEN albo segment jest długi
+ * (zabrakło kotwic w środku), rozszerzamy dopasowanie od obu końców (X-drop). Jeśli
+ * rozszerzenia wyjaśniają krótszy segment, różnicę długości raportujemy jako jedną dużą
+ * delecję / insercję (duplikację tandemową, gdy wstawka powtarza sąsiedni fragment A).
+ * Jeśli zostaje środek podobnej długości, zgodny z dopełnieniem odwrotnym A - jako inwersję.
+ * Flanki porównujemy zwykłym compare_range; w pozostałych przypadkach cały segment.
+ * whole_a to całe A (a = whole_a.substr(off_a, ...)) - źródło duplikacji może leżeć
+ * przed segmentem, np. gdy kotwica wypadła w powielonym fragmencie.
+ * Różnice trafiają do emit od razu, bez listy dla całego segmentu.
+ */
+template<typename Emit>
+void compare_segment(string_view a, string_view b, long off_a, long off_b, bool last, Emit &&emit,
+                     string_view whole_a){
+    long la = a.size(), lb = b.size(), d = la - lb, lmin = min(la, lb);
+    if(labs(d) < SV_MIN_LEN && max(la, lb) < SV_SCAN_LEN){
+        compare_range(a, b, off_a, off_b, last, emit);
+        return;
+    }
+    long x = xdrop_extend(a.data(), b.data(), lmin, 1);
+    long r = xdrop_extend(a.data() + la, b.data() + lb, lmin - x, -1);
+    long mid_a = la - x - r, mid_b = lb - x - r;
+
+    Mutation sv;
+    if(labs(d) >= SV_MIN_LEN && min(mid_a, mid_b) <= SV_SLACK){
+        // duża delecja / insercja tuż za lewą flanką; resztę środka obsłuży prawa flanka
+        if(d > 0) sv = {MUT_DEL, off_a + x, off_b + x, string(a.substr(x, d)), ""};
+        else sv = {MUT_INS, off_a + x, off_b + x, "", string(b.substr(x, -d))};
+    } else if(min(mid_a, mid_b) >= SV_MIN_LEN && labs(mid_a - mid_b) <= min(mid_a, mid_b) / 10
+              && revcomp_identity(a.substr(x, mid_a), b.substr(x, mid_b)) >= 0.8){
+        sv = {MUT_INV, off_a + x, off_b + x, string(a.substr(x, mid_a)), string(b.substr(x, mid_b))};
+    } else {
+        compare_range(a, b, off_a, off_b, last, emit);
+        return;
+    }
 
+    // koniec ostatniej różnicy lewej flanki ogranicza przesunięcie zdarzenia w lewo
+    long lower = off_a;
+    compare_range(a.substr(0, x), b.substr(0, x), off_a, off_b, false, [&](Mutation e){
+        lower = e.pos_a + e.ref.size();
+        emit(move(e));
+    });
+    long skip_a = sv.ref.size(), skip_b = sv.alt.size();
+    if(sv.kind != MUT_INV){
+        left_shift(a, off_a, lower, sv);
+        if(sv.kind == MUT_INS && is_tandem_dup(whole_a, sv.pos_a, sv.alt)) sv.kind = MUT_DUP;
+    }
+    emit(move(sv));
+    compare_range(a.substr(x + skip_a), b.substr(x + skip_b), off_a + x + skip_a, off_b + x + skip_b, last, emit);
+}
+
+/** @brief Porównanie całych sekwencji jednym przebiegiem (jeden wątek) */
+vector<Mutation> compare_seqs(const string &a, const string &b){
+    vector<Mutation> result;
+    compare_segment(a, b, 0, 0, true, [&](Mutation d){ result.push_back(move(d)); }, a);
     return result;
 }
 
+/**
+ * @brief Porównanie strumieniowe: ta sama heurystyka co compare_range, ale na dwóch
+ * strumieniach z oknem wyprzedzenia jednej zasady - stała pamięć dla dowolnie długich wejść
+ * Różnice przekazywane są do emit od razu po wykryciu
+ */
+template<typename Emit>
+void compare_streams(SeqStream &A, SeqStream &B, Emit &&emit){
+    // historia A dla przesuwania indeli w lewo; dłuższych powtórzeń nie przekraczamy
+    A.keep = NORM_HISTORY;
+    IndelNormalizer norm;
+    auto put = [&](Mutation d){ norm.push(move(d), A.window(), A.pos - (long)A.head, emit); };
+    while(A.ensure(2) && B.ensure(2)){
+        const char *a = A.data(), *b = B.data();
+        size_t na = A.avail(), nb = B.avail();
+        if(a[0] == b[0]){
+            norm.flush(A.window(), A.pos - (long)A.head, emit);
+            size_t run = first_mismatch(a, b, min(na, nb));
+            A.consume(run);
+            B.consume(run);
+            continue;
+        }
+        if(na > 1 && nb > 1 && a[1] == b[1]){
+            put(Mutation{MUT_SNP, A.pos, B.pos, string(1, a[0]), string(1, b[0])});
+            A.consume(1); B.consume(1);
+        }
+        else if(na > 1 && a[1] == b[0]){
+            put(Mutation{MUT_DEL, A.pos, B.pos, string(1, a[0]), ""});
+            A.consume(1);
+        }
+        else if(nb > 1 && a[0] == b[1]){
+            put(Mutation{MUT_INS, A.pos, B.pos, "", string(1, b[0])});
+            B.consume(1);
+        }
+        else {
+            put(Mutation{MUT_COMPLEX, A.pos, B.pos, string(1, a[0]), string(1, b[0])});
+            A.consume(1); B.consume(1);
+        }
+    }
+
+    // Końcówka dłuższej sekwencji
+    while(A.ensure(1)){
+        put(Mutation{MUT_DEL, A.pos, B.pos, string(1, A.data()[0]), "", true});
+        A.consume(1);
+    }
+    while(B.ensure(1)){
+        put(Mutation{MUT_INS, A.pos, B.pos, "", string(1, B.data()[0]), true});
+        B.consume(1);
+    }
+    norm.flush(A.window(), A.pos - (long)A.head, emit);
+}
+
+/** @brief Długość k-meru kotwicy (32 zasady = jedno słowo 64-bitowe) */
+static const int ANCHOR_K = 32;
+/** @brief Co ile zasad A próbkujemy kandydata na kotwicę */
+static const int ANCHOR_STEP = 256;
+/**
+ * @brief Od tej długości (64 kb) sekwencje dzielimy kotwicami na niezależne segmenty.
+ * Wynik może się wtedy różnić od jednego przebiegu zachłannego, który po utracie
+ * synchronizacji raportuje resztę sekwencji jako różnice; nie zależy od liczby wątków.
+ */
+static const size_t ANCHOR_MIN_LEN = 1 << 16;
+
+/** @brief Kod 2-bitowy zasady, -1 dla znaków spoza ACGT */
+static inline int base2(char c){
+    switch(c){
+        case 'A': return 0;
+        case 'C': return 1;
+        case 'G': return 2;
+        case 'T': return 3;
+        default: return -1;
+    }
+}
+
+/**
+ * @brief Przejście po wszystkich k-merach ACGT fragmentu [b, e) sekwencji s
+ * f(pozycja_startu, kod) wywoływane dla każdego k-meru bez znaków spoza ACGT (k <= 32)
+ */
+template<typename F>
+void for_each_kmer(const string &s, size_t b, size_t e, F &&f, int k = ANCHOR_K){
+    static const auto lut = []{
+        array<int8_t,256> t;
+        for(int c=0; c<256; c++) t[c] = base2((char)c);
+        return t;
+    }();
+    const uint64_t kmask = k >= 32 ? ~0ull : (1ull << (2 * k)) - 1;
+    uint64_t code = 0;
+    int valid = 0;
+    for(size_t i=b; i<e; i++){
+        int x = lut[(unsigned char)s[i]];
+        if(x < 0){ valid = 0; continue; }
+        code = ((code << 2) | x) & kmask;
+        if(++valid >= k) f(i + 1 - k, code);
+    }
+}
+
+/**
+ * @brief Tablica próbkowanych k-merów A (adresowanie otwarte)
+ * Dla każdego k-meru pamiętamy liczbę wystąpień w A i ostatnią pozycję
+ */
+struct AnchorTable {
+    struct Slot { uint64_t key; long pos_a; uint32_t cnt_a; bool used; };
+    vector<Slot> slots;
+    vector<uint64_t> filter;  // bitmapa skrótów (mieści się w cache) - odsiewa większość chybień
+    size_t mask = 0, fmask = 0;
+
+    void init(size_t expected){
+        size_t cap = 16;
+        while(cap < expected * 2) cap <<= 1;
+        slots.assign(cap, Slot{0, -1, 0, false});
+        mask = cap - 1;
+        filter.assign(cap * 16 / 64, 0);
+        fmask = cap * 16 - 1;
+    }
+    static size_t hash(uint64_t k){ return (k * 0x9E3779B97F4A7C15ULL) >> 17; }
+
+    /** @brief Indeks slotu z kluczem albo -1 */
+    long find(uint64_t key) const {
+        size_t hk = hash(key), fb = (hk >> 20) & fmask;
+        if(!((filter[fb >> 6] >> (fb & 63)) & 1)) return -1;
+        for(size_t h = hk & mask; ; h = (h + 1) & mask){
+            if(!slots[h].used) return -1;
+            if(slots[h].key == key) return h;
+        }
+    }
+    void insert(uint64_t key){
+        size_t hk = hash(key), fb = (hk >> 20) & fmask;
+        filter[fb >> 6] |= 1ull << (fb & 63);
+        for(size_t h = hk & mask; ; h = (h + 1) & mask){
+            if(!slots[h].used){ slots[h] = Slot{key, -1, 0, true}; return; }
+            if(slots[h].key == key) return;
+        }
+    }
+};
+
+/**
+ * @brief Wystąpienia próbkowanych k-merów w sekwencji s, szukane równolegle po przedziałach
+ * Każdy wątek zbiera własną listę par (slot, pozycja); tablica jest tylko czytana
+ */
+vector<pair<long,long>> kmer_hits(const AnchorTable &tab, const string &s, int threads){
+    size_t len = s.size();
+    int parts = max(1, threads);
+    vector<vector<pair<long,long>>> found(parts);
+    auto work = [&](int t){
+        size_t b = len * t / parts, e = len * (t + 1) / parts;
+        // przedział wydłużony o k-1, aby nie zgubić k-merów na granicy
+        for_each_kmer(s, b, min(len, e + ANCHOR_K - 1), [&](size_t p, uint64_t code){
+            if(p >= e) return;
+            long sl = tab.find(code);
+            if(sl >= 0) found[t].push_back({sl, (long)p});
+        });
+    };
+    vector<thread> pool;
+    for(int t=1; t<parts; t++) pool.emplace_back(work, t);
+    work(0);
+    for(auto &th : pool) th.join();
+
+    for(int t=1; t<parts; t++) found[0].insert(found[0].end(), found[t].begin(), found[t].end());
+    return move(found[0]);
+}
+
+/**
+ * @brief Sekwencja referencyjna z indeksem kotwic budowanym raz, przy pierwszej potrzebie
+ * Wiele zapytań (także z różnych wątków) współdzieli jeden indeks
+ */
+struct Reference {
+    string seq;
+    AnchorTable tab;
+    once_flag built;
+
+    const AnchorTable &index(int threads){
+        call_once(built, [&]{
+            tab.init(seq.size() / ANCHOR_STEP + 1);
+            for_each_kmer(seq, 0, seq.size(), [&](size_t p, uint64_t code){
+                if(p % ANCHOR_STEP == 0) tab.insert(code);
+            });
+            for(const auto &h : kmer_hits(tab, seq, threads)){
+                tab.slots[h.first].cnt_a++;
+                tab.slots[h.first].pos_a = h.second;
+            }
+        });
+        return tab;
+    }
+};
+
+/**
+ * @brief Punkty synchronizacji: k-mery unikalne w A i w B, tworzące rosnący łańcuch
+ * Zwraca pary (pozycja w A, pozycja w B) rosnące w obu sekwencjach i nienachodzące na siebie
+ */
+vector<pair<long,long>> find_anchors(Reference &ref, const string &b, int threads){
+    const AnchorTable &tab = ref.index(threads);
+    vector<uint32_t> cnt_b(tab.slots.size(), 0);
+    vector<long> pos_b(tab.slots.size(), -1);
+    for(const auto &h : kmer_hits(tab, b, threads)){
+        cnt_b[h.first]++;
+        pos_b[h.first] = h.second;
+    }
+
+    vector<pair<long,long>> cand;
+    for(size_t k=0; k<tab.slots.size(); k++)
+        if(tab.slots[k].used && tab.slots[k].cnt_a == 1 && cnt_b[k] == 1)
+            cand.push_back({tab.slots[k].pos_a, pos_b[k]});
+    sort(cand.begin(), cand.end());
+
+    // najdłuższy podciąg rosnący po pozycji w B (O(n log n)), z odstępem co najmniej k
+    vector<int> tail, prev(cand.size(), -1);
+    for(int i=0; i<(int)cand.size(); i++){
+        auto it = lower_bound(tail.begin(), tail.end(), i, [&](int x, int y){
+            return cand[x].second < cand[y].second;
+        });
+        int k = it - tail.begin();
+        if(k > 0){
+            // pozycje B muszą być rozłączne z poprzednią kotwicą łańcucha
+            if(cand[tail[k-1]].second + ANCHOR_K > cand[i].second) continue;
+            prev[i] = tail[k-1];
+        }
+        if(it == tail.end()) tail.push_back(i);
+        else *it = i;
+    }
+    vector<pair<long,long>> chain;
+    for(int i = tail.empty() ? -1 : tail.back(); i != -1; i = prev[i]) chain.push_back(cand[i]);
+    reverse(chain.begin(), chain.end());
+    return chain;
+}
+
+/**
+ * @brief Szybka ścieżka dla sekwencji prawie identycznych: kotwice na przekątnej
+ * Próbkę A porównujemy (first_mismatch) z B w miejscu przewidzianym przez poprzednią
+ * kotwicę, a po małym indelu szukamy jej w oknie ±32 zasady. Zwraca pusty wynik,
+ * jeśli tak znaleziono mniej niż 90% kotwic - wtedy potrzebne jest pełne find_anchors.
+ */
+vector<pair<long,long>> diagonal_anchors(const string &a, const string &b){
+    const long W = 32, n = a.size(), m = b.size();
+    vector<pair<long,long>> chain;
+    long diag = 0, min_b = 0, samples = 0;
+    for(long pa=0; pa + ANCHOR_K <= n; pa += ANCHOR_STEP){
+        samples++;
+        long pred = pa + diag, found = -1;
+        for(long d=0; d<=W && found < 0; d++){
+            for(long pb : {pred - d, pred + d}){
+                if(pb < min_b || pb + ANCHOR_K > m) continue;
+                if(first_mismatch(a.data() + pa, b.data() + pb, ANCHOR_K) == (size_t)ANCHOR_K){ found = pb; break; }
+            }
+        }
+        if(found < 0) continue;
+        chain.push_back({pa, found});
+        diag = found - pa;
+        min_b = found + ANCHOR_K;
+    }
+    if(chain.size() * 10 < (size_t)samples * 9) chain.clear();
+    return chain;
+}
+
+/** @brief Ile segmentów naraz (na wątek) może czekać na wydanie w trybie równoległym */
+static const size_t SEG_WINDOW_PER_THREAD = 4;
+
+/**
+ * @brief Porównanie równoległe: kotwice dzielą A i B na niezależne pary segmentów,
+ * segmenty porównywane są współbieżnie, a różnice przekazywane do emit w kolejności pozycji
+ * Jednym wątkiem (i bez kotwic) różnice idą do emit prosto z compare_segment. Wieloma
+ * wątkami wynik segmentu czeka w jednym z threads * SEG_WINDOW_PER_THREAD slotów, aż
+ * zostanie wydany; wątek nie zaczyna segmentu spoza tego okna, więc pamięć nie zależy od
+ * liczby wszystkich różnic.
+ */
+template<typename Emit>
+void compare_seqs_each(Reference &ref, const string &b, int threads, Emit &&emit){
+    const string &a = ref.seq;
+    auto whole = [&]{ compare_segment(a, b, 0, 0, true, emit, a); };
+    if(min(a.size(), b.size()) < ANCHOR_MIN_LEN){ whole(); return; }
+
+    auto anchors = diagonal_anchors(a, b);
+    if(anchors.empty()) anchors = find_anchors(ref, b, threads);
+    if(anchors.empty()){ whole(); return; }
+
+    // segmenty między kotwicami: [a_beg, a_end) x [b_beg, b_end)
+    struct Seg { long a_beg, a_end, b_beg, b_end; };
+    vector<Seg> segs;
+    long pa = 0, pb = 0;
+    for(const auto &an : anchors){
+        segs.push_back({pa, an.first, pb, an.second});
+        pa = an.first + ANCHOR_K;
+        pb = an.second + ANCHOR_K;
+    }
+    segs.push_back({pa, (long)a.size(), pb, (long)b.size()});
+
+    string_view av(a), bv(b);
+    auto segment = [&](size_t k, auto &&out){
+        const Seg &sg = segs[k];
+        compare_segment(av.substr(sg.a_beg, sg.a_end - sg.a_beg), bv.substr(sg.b_beg, sg.b_end - sg.b_beg),
+                        sg.a_beg, sg.b_beg, k + 1 == segs.size(), out, av);
+    };
+    if(threads <= 1){
+        for(size_t k=0; k<segs.size(); k++) segment(k, emit);
+        return;
+    }
+
+    // okno slotów: segment k trafia do slotu k % window, wydawany jest po kolei przez ten wątek
+    size_t window = (size_t)threads * SEG_WINDOW_PER_THREAD;
+    vector<vector<Mutation>> slot(window);
+    vector<char> ready(window, 0);
+    size_t emitted = 0;
+    mutex mu;
+    condition_variable cv;
+    atomic<size_t> next_seg{0};
+    auto worker = [&](){
+        for(size_t k; (k = next_seg++) < segs.size(); ){
+            {
+                unique_lock<mutex> lk(mu);
+                cv.wait(lk, [&]{ return k < emitted + window; });
+            }
+            vector<Mutation> &out = slot[k % window];
+            segment(k, [&](Mutation d){ out.push_back(move(d)); });
+            lock_guard<mutex> lk(mu);
+            ready[k % window] = 1;
+            cv.notify_all();
+        }
+    };
+    vector<thread> pool;
+    for(int t=0; t<threads; t++) pool.emplace_back(worker);
+    for(; emitted < segs.size(); ){
+        size_t s = emitted % window;
+        {
+            unique_lock<mutex> lk(mu);
+            cv.wait(lk, [&]{ return ready[s] != 0; });
+        }
+        for(const auto &d : slot[s]) emit(d);
+        slot[s].clear();
+        if(slot[s].capacity() > (1 << 16)) vector<Mutation>().swap(slot[s]);
+        lock_guard<mutex> lk(mu);
+        ready[s] = 0;
+        emitted++;
+        cv.notify_all();
+    }
+    for(auto &th : pool) th.join();
+}
+
+/** @brief Porównanie równoległe z wynikiem jako jedną listą różnic */
+vector<Mutation> compare_seqs_parallel(Reference &ref, const string &b, int threads){
+    vector<Mutation> result;
+    compare_seqs_each(ref, b, threads, [&](const Mutation &m){ result.push_back(m); });
+    return result;
+}
+
+/** @brief Długość k-meru indeksu referencji dla odczytów (32 bity kodu) */
+static const int READ_K = 16;
+/** @brief Co ile pozycji referencji zapisujemy k-mer w indeksie */
+static const int READ_STEP = 4;
+/** @brief K-mery częstsze niż to w referencji pomijamy (powtórzenia) */
+static const int READ_MAX_OCC = 64;
+/** @brief Połowa szerokości pasma dopasowania wokół przekątnej seeda */
+static const int READ_BAND = 16;
+/** @brief Liczba odczytów pobieranych naraz przez wątek */
+static const size_t READ_BATCH = 4096;
+
+/**
+ * @brief Indeks k-merów referencji: posortowane pary (kod, pozycja) z kubełkami
+ * po 20 najstarszych bitach kodu, więc wyszukiwanie to krótki bisekcja w kubełku
+ */
+struct ReadIndex {
+    vector<uint64_t> entries;  // (kod << 32) | pozycja
+    vector<uint32_t> bucket;   // początki kubełków, 2^20 + 1 wpisów
+
+    void build(const string &ref){
+        for_each_kmer(ref, 0, ref.size(), [&](size_t p, uint64_t code){
+            if(p % READ_STEP == 0) entries.push_back(code << 32 | p);
+        }, READ_K);
+        sort(entries.begin(), entries.end());
+
+        // usuwamy k-mery powtórzone zbyt wiele razy
+        size_t w = 0;
+        for(size_t i=0; i<entries.size(); ){
+            size_t j = i;
+            while(j < entries.size() && (entries[j] >> 32) == (entries[i] >> 32)) j++;
+            if(j - i <= (size_t)READ_MAX_OCC)
+                for(size_t t=i; t<j; t++) entries[w++] = entries[t];
+            i = j;
+        }
+        entries.resize(w);
+        entries.shrink_to_fit();
+
+        bucket.assign((1 << 20) + 1, 0);
+        for(uint64_t e : entries) bucket[(e >> 44) + 1]++;
+        for(size_t b=1; b<bucket.size(); b++) bucket[b] += bucket[b-1];
+    }
+
+    template<typename F>
+    void lookup(uint64_t code, F &&f) const {
+        auto b = entries.begin() + bucket[code >> 12], e = entries.begin() + bucket[(code >> 12) + 1];
+        for(auto it = lower_bound(b, e, code << 32); it != e && (*it >> 32) == code; ++it)
+            f((long)(uint32_t)*it);
+    }
+};
+
+/**
+ * @brief Źródło odczytów FASTQ/FASTA współdzielone przez wątki
+ * Wątek pobiera pod blokadą całą paczkę odczytów do własnego, ponownie używanego wektora
+ */
+struct ReadSource {
+    ifstream in;
+    bool fastq = false;
+    string pending;  // nagłówek kolejnego rekordu FASTA
+    mutex mu;
+
+    bool open(const string &path){
+        if(!open_input(in, path)) return false;
+        fastq = in.peek() == '@';
+        return true;
+    }
+
+    /** @brief Kolejna paczka odczytów; false, gdy nie ma już nic do przetworzenia */
+    bool next_batch(vector<string> &batch, size_t &count){
+        lock_guard<mutex> lock(mu);
+        count = 0;
+        string line;
+        while(count < READ_BATCH){
+            if(count == batch.size()) batch.emplace_back();
+            string &seq = batch[count];
+            seq.clear();
+            if(fastq){
+                string plus, qual;
+                if(!getline(in, line) || !getline(in, seq) || !getline(in, plus) || !getline(in, qual)) break;
+            } else {
+                bool any = false;
+                while(getline(in, line)){
+                    if(!line.empty() && line[0] == '>'){
+                        if(any) break;
+                        continue;
+                    }
+                    any = true;
+                    seq += line;
+                }
+                if(!any) break;
+            }
+            size_t w = 0;
+            for(char c : seq) if(!isspace((unsigned char)c)) seq[w++] = toupper(c);
+            seq.resize(w);
+            count++;
+        }
+        return count > 0;
+    }
+};
+
+/** @brief Liczba pozycji referencji na stronę liczników pileupu */
+static const long PILEUP_PAGE = 1 << 16;
+
+/**
+ * @brief Dowody z odczytów zebrane przez jeden wątek
+ * Gęste liczniki na pozycję referencji: zasady A/C/G/T odczytu różne od referencji
+ * i delecje jednej zasady. Strony po PILEUP_PAGE pozycji alokujemy przy pierwszym
+ * trafieniu, więc pamięć rośnie z pokrytą częścią referencji. Insercje, dłuższe delecje
+ * i SNP z innymi literami trafiają do tablicy bocznej (rzadkie), zliczanej przy scalaniu.
+ */
+struct ReadEvidence {
+    static const int DEL = 4;                        // indeks licznika delecji jednej zasady
+    vector<unique_ptr<array<uint32_t,5>[]>> pages;
+    vector<tuple<long,int,string>> side;             // (pozycja, MutKind, allel), po jednym na odczyt
+    size_t reads = 0, mapped = 0;
+
+    explicit ReadEvidence(size_t ref_len = 0) : pages((ref_len + PILEUP_PAGE - 1) / PILEUP_PAGE) {}
+
+    array<uint32_t,5> &at(long p){
+        auto &pg = pages[p / PILEUP_PAGE];
+        if(!pg) pg.reset(new array<uint32_t,5>[PILEUP_PAGE]());
+        return pg[p % PILEUP_PAGE];
+    }
+
+    void add(long p, MutKind kind, string_view allele){
+        int b = allele.size() == 1 ? base2(allele[0]) : -1;
+        if(kind == MUT_SNP && b >= 0) at(p)[b]++;
+        else if(kind == MUT_DEL && allele.size() == 1) at(p)[DEL]++;
+        else side.emplace_back(p, kind, string(allele));
+    }
+
+    /** @brief Dołączenie liczników innego wątku (jego strony są zwalniane) */
+    void merge(ReadEvidence &o){
+        for(size_t g=0; g<pages.size(); g++){
+            if(!o.pages[g]) continue;
+            if(!pages[g]){ pages[g] = move(o.pages[g]); continue; }
+            for(long i=0; i<PILEUP_PAGE; i++)
+                for(int c=0; c<5; c++) pages[g][i][c] += o.pages[g][i][c];
+            o.pages[g].reset();
+        }
+        side.insert(side.end(), make_move_iterator(o.side.begin()), make_move_iterator(o.side.end()));
+        vector<tuple<long,int,string>>().swap(o.side);
+        reads += o.reads;
+        mapped += o.mapped;
+    }
+};
+
+/**
+ * @brief Dopasowanie odczytu do okna referencji w paśmie wokół przekątnej diag
+ * Globalne względem odczytu, z wolnymi końcami w referencji. Zdarzenia (SNP, insercje,
+ * delecje) trafiają do ev, a pokrycie pozycji referencji do depth.
+ * Zwraca false, gdy wynik dopasowania jest zbyt słaby.
+ */
+bool align_read(const string &ref, const string &read, long diag, vector<int> &H, vector<uint8_t> &tb,
+                ReadEvidence &ev, vector<uint32_t> &depth){
+    const int MATCH = 2, MIS = -3, GAP_OPEN = -6, GAP_EXT = -1, NEG = INT_MIN / 2;
+    const int W = 2 * READ_BAND + 1, L = read.size();
+    const long n = ref.size(), r0 = diag - READ_BAND;
+
+    // Szybka ścieżka: odczyt bez indeli (kilka niezgodności na samej przekątnej)
+    if(diag >= 0 && diag + L <= n){
+        int mis = 0;
+        for(int i=0; i<L && mis <= L / 50; i++) mis += read[i] != ref[diag + i];
+        if(mis <= L / 50){
+            for(int i=0; i<L; i++){
+                __atomic_fetch_add(&depth[diag + i], 1, __ATOMIC_RELAXED);
+                if(read[i] != ref[diag + i] && read[i] != 'N')
+                    ev.add(diag + i, MUT_SNP, string_view(&read[i], 1));
+            }
+            return true;
+        }
+    }
+    // Gotoh w paśmie: trzy stany (M - zgodność/niezgodność, I - insercja, D - delecja)
+    // H przechowuje 3 wyniki na komórkę, tb - poprzedni stan dla każdego z nich (po 2 bity)
+    auto cell = [&](int i, int k) -> int* { return &H[((size_t)i * W + k) * 3]; };
+    H.assign((size_t)(L + 1) * W * 3, NEG);
+    tb.assign((size_t)(L + 1) * W, 0);
+
+    for(int k=0; k<W; k++) if(r0 + k >= 0 && r0 + k <= n) cell(0, k)[0] = 0;
+    for(int i=1; i<=L; i++){
+        for(int k=0; k<W; k++){
+            long rp = r0 + i + k;  // pozycja referencji za ostatnim dopasowanym znakiem
+            if(rp < 0 || rp > n) continue;
+            int *c = cell(i, k);
+            uint8_t t = 0;
+            if(rp >= 1){
+                const int *p = cell(i-1, k);
+                int b = max_element(p, p + 3) - p;
+                if(p[b] > NEG){
+                    c[0] = p[b] + (read[i-1] == ref[rp-1] ? MATCH : MIS);
+                    t |= b;
+                }
+            }
+            if(k + 1 < W){
+                const int *p = cell(i-1, k+1);
+                int o = max(p[0], p[2]) + GAP_OPEN, e = p[1] + GAP_EXT;
+                if(max(o, e) > NEG / 2){
+                    c[1] = max(o, e);
+                    t |= (e >= o ? 1 : (p[0] >= p[2] ? 0 : 2)) << 2;
+                }
+            }
+            if(k > 0 && rp >= 1){
+                const int *p = cell(i, k-1);
+                int o = max(p[0], p[1]) + GAP_OPEN, e = p[2] + GAP_EXT;
+                if(max(o, e) > NEG / 2){
+                    c[2] = max(o, e);
+                    t |= (e >= o ? 2 : (p[0] >= p[1] ? 0 : 1)) << 4;
+                }
+            }
+            tb[(size_t)i * W + k] = t;
+        }
+    }
+
+    int bk = 0, bs = 0;
+    for(int k=0; k<W; k++)
+        for(int st=0; st<3; st++)
+            if(cell(L, k)[st] > cell(L, bk)[bs]){ bk = k; bs = st; }
+    // co najmniej ~85% zgodności
+    if(cell(L, bk)[bs] < L * MATCH * 7 / 10) return false;
+
+    // ścieżka wsteczna: zbieramy zdarzenia (od końca odczytu), łącząc sąsiednie insercje / delecje
+    int i = L, k = bk, state = bs;
+    vector<Mutation> evs;
+    string ins, del;
+    long ins_pos = -1, del_pos = -1;
+    auto flush = [&](){
+        if(!ins.empty()){ reverse(ins.begin(), ins.end()); evs.push_back({MUT_INS, ins_pos, i, "", ins}); ins.clear(); }
+        if(!del.empty()){ reverse(del.begin(), del.end()); evs.push_back({MUT_DEL, del_pos, i, del, ""}); del.clear(); }
+    };
+    while(i > 0){
+        long rp = r0 + i + k;
+        int dir = state;
+        state = (tb[(size_t)i*W + k] >> (2 * dir)) & 3;
+        if(dir == 0){
+            flush();
+            __atomic_fetch_add(&depth[rp-1], 1, __ATOMIC_RELAXED);
+            if(read[i-1] != ref[rp-1] && read[i-1] != 'N')
+                evs.push_back({MUT_SNP, rp-1, i-1, string(1, ref[rp-1]), string(1, read[i-1])});
+            i--;
+        } else if(dir == 1){
+            if(!del.empty()) flush();
+            ins.push_back(read[i-1]);
+            ins_pos = rp;
+            i--; k++;
+        } else {
+            if(!ins.empty()) flush();
+            __atomic_fetch_add(&depth[rp-1], 1, __ATOMIC_RELAXED);
+            del.push_back(ref[rp-1]);
+            del_pos = rp - 1;
+            k--;
+        }
+    }
+    flush();
+
+    // zdarzenia w kolejności referencji, indele przesunięte w lewo w obrębie odczytu
+    IndelNormalizer norm;
+    norm.lower = r0 + k;
+    auto add = [&](const Mutation &d){ ev.add(d.pos_a, d.kind, d.kind == MUT_DEL ? d.ref : d.alt); };
+    for(auto it = evs.rbegin(); it != evs.rend(); ++it) norm.push(move(*it), ref, 0, add);
+    norm.flush(ref, 0, add);
+    return true;
+}
+
+/**
+ * @brief Przekątna (pozycja referencji - pozycja w odczycie) z największą liczbą seedów
+ * Zwraca liczbę głosów; diagonale w odległości do READ_BAND/2 głosują razem
+ */
+int best_diagonal(const ReadIndex &idx, const string &read, vector<long> &diags, long &best){
+    diags.clear();
+    for_each_kmer(read, 0, read.size(), [&](size_t p, uint64_t code){
+        idx.lookup(code, [&](long rpos){ diags.push_back(rpos - (long)p); });
+    }, READ_K);
+    sort(diags.begin(), diags.end());
+    int votes = 0;
+    for(size_t b=0, e=0; e<diags.size(); e++){
+        while(diags[e] - diags[b] > READ_BAND / 2) b++;
+        if((int)(e - b + 1) > votes){ votes = e - b + 1; best = diags[b + (e - b) / 2]; }
+    }
+    return votes;
+}
+
+/**
+ * @brief Tryb odczytów: seed (indeks k-merów referencji), rozszerzenie dopasowaniem w paśmie,
+ * zliczanie dowodów SNP / indeli na pozycję i wywołanie wariantów
+ * Wątki przetwarzają kolejne paczki odczytów; każdy ma własne bufory i własne liczniki
+ * pileupu, scalane po zakończeniu wątków
+ */
+int run_reads(const string &ref, const string &reads_path, int threads, uint32_t min_alt, double min_frac){
+    auto t0 = chrono::high_resolution_clock::now();
+    ReadIndex idx;
+    idx.build(ref);
+
+    ReadSource src;
+    if(!src.open(reads_path)){
+        cerr << "Cannot open reads: " << reads_path << "\n";
+        return 1;
+    }
+
+    vector<uint32_t> depth(ref.size(), 0);
+    vector<ReadEvidence> ev;
+    for(int t=0; t<threads; t++) ev.emplace_back(ref.size());
+    auto worker = [&](int t){
+        vector<string> batch;
+        vector<long> diags;
+        vector<int> H;
+        vector<uint8_t> tb;
+        string rc;
+        size_t count;
+        while(src.next_batch(batch, count)){
+            for(size_t r=0; r<count; r++){
+                const string &read = batch[r];
+                ev[t].reads++;
+                if((int)read.size() < READ_K + READ_STEP) continue;
+                long df = 0, dr = 0;
+                int vf = best_diagonal(idx, read, diags, df);
+                revcomp(read, rc);
+                int vr = best_diagonal(idx, rc, diags, dr);
+                if(max(vf, vr) < 2) continue;
+                const string &s = vf >= vr ? read : rc;
+                if(align_read(ref, s, vf >= vr ? df : dr, H, tb, ev[t], depth)) ev[t].mapped++;
+            }
+        }
+    };
+    vector<thread> pool;
+    for(int t=1; t<threads; t++) pool.emplace_back(worker, t);
+    worker(0);
+    for(auto &th : pool) th.join();
+
+    // scalanie dowodów z wątków
+    ReadEvidence &all = ev[0];
+    for(int t=1; t<threads; t++) all.merge(ev[t]);
+    auto t1 = chrono::high_resolution_clock::now();
+
+    // kandydaci: (pozycja, MutKind, allel) z liczbą odczytów, w kolejności miejsca
+    vector<pair<tuple<long,int,string>, uint32_t>> cand;
+    auto consider = [&](long p, int kind, string al, uint32_t cnt){
+        uint32_t d = depth[min<long>(p, ref.size() - 1)];
+        if(cnt < min_alt || cnt < min_frac * d) return;
+        cand.push_back({{p, kind, move(al)}, cnt});
+    };
+    static const char BASES[] = "ACGT";
+    for(size_t g=0; g<all.pages.size(); g++){
+        if(!all.pages[g]) continue;
+        for(long i=0; i<PILEUP_PAGE && (long)g * PILEUP_PAGE + i < (long)ref.size(); i++){
+            const auto &c = all.pages[g][i];
+            long p = g * PILEUP_PAGE + i;
+            for(int b=0; b<4; b++) if(c[b]) consider(p, MUT_SNP, string(1, BASES[b]), c[b]);
+            if(c[ReadEvidence::DEL]) consider(p, MUT_DEL, string(1, ref[p]), c[ReadEvidence::DEL]);
+        }
+    }
+    sort(all.side.begin(), all.side.end());
+    for(size_t b=0, e; b<all.side.size(); b = e){
+        for(e = b + 1; e < all.side.size() && all.side[e] == all.side[b]; e++);
+        consider(get<0>(all.side[b]), get<1>(all.side[b]), get<2>(all.side[b]), e - b);
+    }
+    sort(cand.begin(), cand.end());
+
+    vector<Mutation> calls;
+    vector<pair<uint32_t,uint32_t>> support;
+    for(auto &e : cand){
+        long p = get<0>(e.first);
+        MutKind kind = (MutKind)get<1>(e.first);
+        string &al = get<2>(e.first);
+        if(kind == MUT_SNP) calls.push_back({kind, p, -1, string(1, ref[p]), al});
+        else if(kind == MUT_DEL) calls.push_back({kind, p, -1, al, ""});
+        else calls.push_back({kind, p, -1, "", al});
+        support.push_back({e.second, depth[min<long>(p, ref.size() - 1)]});
+    }
+
+    cout << "Detected variants (" << calls.size() << "):\n";
+    for(size_t k=0; k<calls.size(); k++)
+        cout << " - " << describe(calls[k]) << " (reads: " << support[k].first
+             << ", depth: " << support[k].second << ")\n";
+    cerr << "Reads: " << ev[0].reads << ", Mapped: " << ev[0].mapped
+         << ", Index k-mers: " << idx.entries.size()
+         << ", Time: " << chrono::duration<double>(t1 - t0).count() << " s\n";
+    return 0;
+}
+
+/** @brief Liczba par w jednym zadaniu wątku w trybie --pairs */
+static const size_t PAIR_JOB = 256;
+/** @brief Liczba par wczytywanych naraz (porcja przetwarzana przez pulę wątków) */
+static const size_t PAIR_CHUNK = 1 << 16;
+
+/**
+ * @brief Podział linii na najwyżej n pól rozdzielonych białymi znakami
+ * Pola trafiają do buforów f[0..n) wątku (assign nie alokuje, gdy bufor ma już miejsce)
+ * @return Liczba znalezionych pól
+ */
+static int split_fields(string_view line, string *f, int n){
+    static const char *ws = " \t\r\v\f";
+    int k = 0;
+    for(size_t i = line.find_first_not_of(ws); k < n && i != string_view::npos; i = line.find_first_not_of(ws, i)){
+        size_t e = min(line.find_first_of(ws, i), line.size());
+        f[k++].assign(line, i, e - i);
+        i = e;
+    }
+    return k;
+}
+
+/**
+ * @brief Tryb wsadowy: wiele krótkich par sekwencji z jednego pliku
+ * Każda linia to "seqA seqB" albo "id seqA seqB" (linie puste i '#' pomijamy).
+ * Plik czytamy porcjami; w porcji wątki pobierają kolejne zadania po PAIR_JOB par,
+ * używając własnych buforów (sekwencje, lista różnic) i formatując wynik do bufora zadania.
+ * Wyniki wypisujemy w kolejności wejścia: id, liczba różnic, opisy rozdzielone "; ".
+ */
+int run_pairs(const string &path, int threads){
+    ifstream in;
+    if(!open_input(in, path)){
+        cerr << "Cannot open pairs file: " << path << "\n";
+        return 1;
+    }
+    auto t0 = chrono::high_resolution_clock::now();
+    vector<string> lines;
+    vector<long> line_no;
+    vector<string> outs;
+    size_t pairs = 0, bad = 0;
+    long no = 0;
+    for(bool more = true; more; ){
+        lines.clear();
+        line_no.clear();
+        string line;
+        while(lines.size() < PAIR_CHUNK && (more = (bool)getline(in, line))){
+            no++;
+            if(line.empty() || line[0] == '#') continue;
+            lines.push_back(move(line));
+            line_no.push_back(no);
+        }
+        size_t jobs = (lines.size() + PAIR_JOB - 1) / PAIR_JOB;
+        outs.assign(jobs, string());
+        atomic<size_t> next_job{0};
+        atomic<size_t> bad_lines{0};
+        auto worker = [&](){
+            vector<Mutation> muts;
+            string f[3];
+            for(size_t k; (k = next_job++) < jobs; ){
+                string &out = outs[k];
+                for(size_t l = k * PAIR_JOB; l < min(lines.size(), (k + 1) * PAIR_JOB); l++){
+                    int nf = split_fields(lines[l], f, 3);
+                    if(nf < 2){ bad_lines++; continue; }
+                    string &a = f[nf - 2], &b = f[nf - 1];
+                    for(char &c : a) c = toupper(c);
+                    for(char &c : b) c = toupper(c);
+                    muts.clear();
+                    compare_segment(a, b, 0, 0, true, [&](Mutation d){ muts.push_back(move(d)); }, a);
+                    if(nf == 3) out += f[0];
+                    else out += to_string(line_no[l]);
+                    out += '\t';
+                    out += to_string(muts.size());
+                    out += '\t';
+                    if(muts.empty()) out += '-';
+                    for(size_t d=0; d<muts.size(); d++){
+                        if(d) out += "; ";
+                        out += describe(muts[d]);
+                    }
+                    out += '\n';
+                }
+            }
+        };
+        int workers = max(1, min<int>(threads, jobs));
+        vector<thread> pool;
+        for(int t=1; t<workers; t++) pool.emplace_back(worker);
+        worker();
+        for(auto &th : pool) th.join();
+
+        for(const auto &o : outs) cout.write(o.data(), o.size());
+        pairs += lines.size() - bad_lines;
+        bad += bad_lines;
+    }
+    cout.flush();
+    auto t1 = chrono::high_resolution_clock::now();
+    if(bad) cerr << "Warning: skipped " << bad << " malformed lines\n";
+    cerr << "Pairs: " << pairs << ", Time: " << chrono::duration<double>(t1 - t0).count() << " s\n";
+    return 0;
+}
+
+/**
+ * @brief Nazwa próbki: nazwa pliku bez katalogu i ostatniego rozszerzenia (razem z ".gz")
+ * "s1.v2.fa" -> "s1.v2", "s1.fa.gz" -> "s1"
+ */
+string sample_name(const string &path){
+    string base = filesystem::path(path).filename().string();
+    if(base.size() > 3 && base.compare(base.size() - 3, 3, ".gz") == 0) base.resize(base.size() - 3);
+    size_t dot = base.rfind('.');
+    return dot == string::npos || dot == 0 ? base : base.substr(0, dot);
+}
+
+/** @brief Klucz miejsca mutacji w macierzy: pozycja w referencji, typ, ref, alt */
+using SiteKey = tuple<long, int, string, string>;
+
+static SiteKey site_key(const Mutation &m){ return {m.pos_a, (int)m.kind, m.ref, m.alt}; }
+
+/** @brief Krótka nazwa typu różnicy (kolumna macierzy) */
+static const char *kind_name(MutKind k){
+    switch(k){
+        case MUT_SNP: return "SNP";
+        case MUT_DEL: return "DEL";
+        case MUT_INS: return "INS";
+        case MUT_DUP: return "DUP";
+        case MUT_INV: return "INV";
+        default: return "COMPLEX";
+    }
+}
+
+/** @brief Górne granice przedziałów histogramu długości indeli (ostatni - bez ograniczenia) */
+static const long INDEL_BINS[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 20, 50, 100, 1000, LONG_MAX};
+static const int N_INDEL_BINS = sizeof(INDEL_BINS) / sizeof(INDEL_BINS[0]);
+
+/**
+ * @brief Podsumowanie różnic zbierane w locie (tryb --summary)
+ * Liczniki typów, tranzycji / transwersji, histogram długości indeli i gęstość różnic
+ * w oknach - stała pamięć na kategorię (plus jeden licznik na okno), zamiast pełnej listy.
+ */
+struct MutationSummary {
+    long window;
+    array<uint64_t, 6> by_kind{};
+    uint64_t ts = 0, tv = 0;
+    array<uint64_t, N_INDEL_BINS> del_len{}, ins_len{};
+    vector<uint64_t> density;
+
+    explicit MutationSummary(long w) : window(max(1L, w)) {}
+
+    static bool purine(char c){ return c == 'A' || c == 'G'; }
+
+    void add(const Mutation &m){
+        by_kind[m.kind]++;
+        if(m.kind == MUT_SNP && m.ref != m.alt){
+            // tranzycja: puryna <-> puryna albo pirymidyna <-> pirymidyna
+            if(purine(m.ref[0]) == purine(m.alt[0])) ts++;
+            else tv++;
+        }
+        if(m.kind == MUT_DEL || m.kind == MUT_INS || m.kind == MUT_DUP){
+            long len = m.kind == MUT_DEL ? m.ref.size() : m.alt.size();
+            int bin = lower_bound(INDEL_BINS, INDEL_BINS + N_INDEL_BINS, len) - INDEL_BINS;
+            (m.kind == MUT_DEL ? del_len : ins_len)[bin]++;
+        }
+        size_t w = max(0L, m.pos_a) / window;
+        if(density.size() <= w) density.resize(w + 1, 0);
+        density[w]++;
+    }
+
+    static string bin_label(int b){
+        long lo = b ? INDEL_BINS[b-1] + 1 : 1, hi = INDEL_BINS[b];
+        if(hi == LONG_MAX) return ">" + to_string(lo - 1);
+        return lo == hi ? to_string(lo) : to_string(lo) + "-" + to_string(hi);
+    }
+
+    /** @brief Zapis w formacie JSON; len_a / len_b - długości porównywanych sekwencji */
+    void write_json(ostream &out, long len_a, long len_b, const string &indent = "") const {
+        uint64_t total = accumulate(by_kind.begin(), by_kind.end(), uint64_t(0));
+        out << "{\n" << indent << "  \"length_a\": " << len_a << ",\n"
+            << indent << "  \"length_b\": " << len_b << ",\n"
+            << indent << "  \"total\": " << total << ",\n"
+            << indent << "  \"counts\": {";
+        for(int k=0; k<(int)by_kind.size(); k++)
+            out << (k ? ", " : "") << "\"" << kind_name((MutKind)k) << "\": " << by_kind[k];
+        out << "},\n" << indent << "  \"transitions\": " << ts << ",\n"
+            << indent << "  \"transversions\": " << tv << ",\n"
+            << indent << "  \"ts_tv\": ";
+        if(tv) out << (double)ts / tv;
+        else out << "null";
+        out << ",\n";
+        auto hist = [&](const char *name, const array<uint64_t, N_INDEL_BINS> &h){
+            out << indent << "  \"" << name << "\": {";
+            for(int b=0; b<N_INDEL_BINS; b++)
+                out << (b ? ", " : "") << "\"" << bin_label(b) << "\": " << h[b];
+            out << "},\n";
+        };
+        hist("deletion_lengths", del_len);
+        hist("insertion_lengths", ins_len);
+        out << indent << "  \"window\": " << window << ",\n"
+            << indent << "  \"density\": [";
+        size_t windows = max<size_t>(density.size(), (max(len_a, 1L) + window - 1) / window);
+        for(size_t w=0; w<windows; w++) out << (w ? ", " : "") << (w < density.size() ? density[w] : 0);
+        out << "]\n" << indent << "}";
+    }
+};
+
+/**
+ * @brief Tryb wielu próbek: jedna referencja, wiele zapytań porównywanych równolegle
+ * Referencja i jej indeks kotwic wczytywane są raz. Każda próbka dostaje listę różnic
+ * (plik w out_dir albo sekcja na stdout) lub jej podsumowanie JSON (summary_window > 0),
+ * a opcjonalna macierz miejsce x próbka (0/1) scala wszystkie różnice.
+ */
+int run_multi(Reference &ref, const vector<string> &queries, const string &out_dir,
+              const string &matrix_path, int threads, long summary_window){
+    // nazwy próbek wyznaczają pliki wyjściowe i kolumny macierzy - muszą być unikalne
+    unordered_map<string, size_t> seen;
+    for(size_t k=0; k<queries.size(); k++){
+        auto [it, fresh] = seen.emplace(sample_name(queries[k]), k);
+        if(!fresh){
+            cerr << "Duplicate sample name '" << it->first << "': " << queries[it->second]
+                 << " and " << queries[k] << "\n";
+            return 1;
+        }
+    }
+
+    // z podsumowaniem różnic nie przechowujemy: liczniki (i klucze miejsc dla macierzy)
+    // zbierane są w locie, tym samym wywołaniem zwrotnym co w trybie --stream
+    vector<vector<Mutation>> res(queries.size());
+    vector<vector<SiteKey>> per(queries.size());
+    vector<MutationSummary> sums(queries.size(), MutationSummary(summary_window));
+    vector<long> len_b(queries.size(), 0);
+    atomic<size_t> next_job{0};
+    auto worker = [&](){
+        for(size_t k; (k = next_job++) < queries.size(); ){
+            string B = load_text(queries[k]);
+            len_b[k] = B.size();
+            if(summary_window > 0){
+                compare_seqs_each(ref, B, 1, [&](const Mutation &m){
+                    sums[k].add(m);
+                    if(!matrix_path.empty()) per[k].push_back(site_key(m));
+                });
+            } else {
+                res[k] = compare_seqs_parallel(ref, B, 1);
+                if(!matrix_path.empty()) for(const auto &d : res[k]) per[k].push_back(site_key(d));
+            }
+            if(!out_dir.empty() && summary_window > 0){
+                ofstream out(out_dir + "/" + sample_name(queries[k]) + ".summary.json");
+                sums[k].write_json(out, ref.seq.size(), len_b[k]);
+                out << "\n";
+            } else if(!out_dir.empty()){
+                ofstream out(out_dir + "/" + sample_name(queries[k]) + ".mut.txt");
+                out << "Detected differences (" << res[k].size() << "):\n";
+                for(const auto &d : res[k]) out << " - " << describe(d) << "\n";
+            }
+        }
+    };
+    int workers = max(1, min<int>(threads, queries.size()));
+    vector<thread> pool;
+    for(int t=1; t<workers; t++) pool.emplace_back(worker);
+    worker();
+    for(auto &th : pool) th.join();
+
+    if(out_dir.empty() && summary_window > 0){
+        // jeden obiekt JSON: nazwa próbki -> podsumowanie
+        cout << "{\n";
+        for(size_t k=0; k<queries.size(); k++){
+            cout << "  \"" << sample_name(queries[k]) << "\": ";
+            sums[k].write_json(cout, ref.seq.size(), len_b[k], "  ");
+            cout << (k + 1 < queries.size() ? ",\n" : "\n");
+        }
+        cout << "}\n";
+    } else if(out_dir.empty()){
+        for(size_t k=0; k<queries.size(); k++){
+            cout << "== " << sample_name(queries[k]) << " ==\n"
+                 << "Detected differences (" << res[k].size() << "):\n";
+            for(const auto &d : res[k]) cout << " - " << describe(d) << "\n";
+        }
+    }
+
+    if(!matrix_path.empty()){
+        // wszystkie miejsca posortowane po pozycji; kolumny próbek przez scalanie posortowanych list
+        vector<SiteKey> sites;
+        for(size_t k=0; k<queries.size(); k++){
+            sort(per[k].begin(), per[k].end());
+            sites.insert(sites.end(), per[k].begin(), per[k].end());
+        }
+        sort(sites.begin(), sites.end());
+        sites.erase(unique(sites.begin(), sites.end()), sites.end());
+
+        ofstream out(matrix_path);
+        if(!out){
+            cerr << "Cannot create matrix file: " << matrix_path << "\n";
+            return 1;
+        }
+        out << "pos\ttype\tref\talt";
+        for(const auto &q : queries) out << "\t" << sample_name(q);
+        out << "\n";
+        vector<size_t> at(queries.size(), 0);
+        for(const auto &st : sites){
+            out << get<0>(st) << "\t" << kind_name((MutKind)get<1>(st)) << "\t"
+                << (get<2>(st).empty() ? "-" : get<2>(st)) << "\t" << (get<3>(st).empty() ? "-" : get<3>(st));
+            for(size_t k=0; k<queries.size(); k++){
+                bool has = at[k] < per[k].size() && per[k][at[k]] == st;
+                // ta sama próbka może mieć kilka identycznych wpisów (np. końcówki)
+                while(at[k] < per[k].size() && per[k][at[k]] == st) at[k]++;
+                out << "\t" << (has ? 1 : 0);
+            }
+            out << "\n";
+        }
+    }
+
+    cerr << "Samples: " << queries.size() << ", Reference length: " << ref.seq.size() << "\n";
+    return 0;
+}
+
 /**
  * @brief Punkt wejścia programu
- * Obsługuje argumenty wiersza poleceń: ./program plik1 plik2
+ * Obsługuje argumenty wiersza poleceń: ./program plik1 plik2 [--threads N] [--summary]
  */
 int main(int argc, char **argv){
-    if(argc < 3){
-        cerr << "Sposób użycia: " << argv[0] << " <seqA|fileA> <seqB|fileB>\n";
+    vector<string> pos;
+    int threads = max(1u, thread::hardware_concurrency());
+    bool stream = false, summary = false;
+    long window = 100000;
+    string ref_path, out_dir, matrix_path, reads_path, pairs_path;
+    uint32_t min_alt = 2;
+    double min_frac = 0.2;
+    for(int a=1; a<argc; a++){
+        string arg = argv[a];
+        if(arg == "--threads" && a+1 < argc) threads = max(1, stoi(argv[++a]));
+        else if(arg == "--stream") stream = true;
+        else if(arg == "--summary") summary = true;
+        else if(arg == "--window" && a+1 < argc) window = max(1L, stol(argv[++a]));
+        else if(arg == "--ref" && a+1 < argc) ref_path = argv[++a];
+        else if(arg == "--out-dir" && a+1 < argc) out_dir = argv[++a];
+        else if(arg == "--matrix" && a+1 < argc) matrix_path = argv[++a];
+        else if(arg == "--reads" && a+1 < argc) reads_path = argv[++a];
+        else if(arg == "--pairs" && a+1 < argc) pairs_path = argv[++a];
+        else if(arg == "--min-alt" && a+1 < argc) min_alt = stoul(argv[++a]);
+        else if(arg == "--min-frac" && a+1 < argc) min_frac = stod(argv[++a]);
+        else pos.push_back(arg);
+    }
+
+    // Wiele par z jednego pliku w jednym procesie
+    if(!pairs_path.empty()) return run_pairs(pairs_path, threads);
+
+    // Odczyty FASTQ/FASTA względem referencji: seed-and-extend i pileup
+    if(!ref_path.empty() && !reads_path.empty()){
+        string R = load_text(ref_path);
+        if(R.empty()){
+            cerr << "Cannot read reference: " << ref_path << "\n";
+            return 1;
+        }
+        return run_reads(R, reads_path, threads, min_alt, min_frac);
+    }
+
+    // Jedna referencja, wiele próbek (pliki albo @lista)
+    if(!ref_path.empty()){
+        vector<string> queries;
+        for(const auto &q : pos){
+            if(q.size() > 1 && q[0] == '@'){
+                ifstream in(q.substr(1));
+                if(!in){
+                    cerr << "Cannot open sample list: " << q.substr(1) << "\n";
+                    return 1;
+                }
+                for(string line; getline(in, line); ){
+                    // listy z Windows (CRLF) i spacje na końcu linii nie są częścią ścieżki
+                    size_t b = line.find_first_not_of(" \t\r"), e = line.find_last_not_of(" \t\r");
+                    if(b == string::npos || line[b] == '#') continue;
+                    queries.push_back(line.substr(b, e - b + 1));
+                }
+            } else queries.push_back(q);
+        }
+        if(queries.empty()){
+            cerr << "Sposób użycia: " << argv[0] << " --ref <fileA> <fileB...|@list> [--out-dir DIR] [--matrix out.tsv] [--summary] [--threads N]\n";
+            return 1;
+        }
+        Reference ref;
+        ref.seq = load_text(ref_path);
+        if(ref.seq.empty()){
+            cerr << "Cannot read reference: " << ref_path << "\n";
+            return 1;
+        }
+        return run_multi(ref, queries, out_dir, matrix_path, threads, summary ? window : 0);
+    }
+
+    if(pos.size() < 2){
+        cerr << "Sposób użycia: " << argv[0] << " <seqA|fileA> <seqB|fileB> [--threads N] [--stream] [--summary [--window N]]\n"
+             << "               " << argv[0] << " --ref <fileA> <fileB...|@list> [--out-dir DIR] [--matrix out.tsv] [--summary] [--threads N]\n"
+             << "               " << argv[0] << " --ref <fileA> --reads <reads.fq> [--min-alt N] [--min-frac F] [--threads N]\n"
+             << "               " << argv[0] << " --pairs <pairs.txt> [--threads N]\n";
         return 1;
     }
 
+    if(pos[0] == "-" && pos[1] == "-"){
+        cerr << "Only one input can be read from stdin\n";
+        return 1;
+    }
+
+    // Tryb strumieniowy: stała pamięć, różnice wypisywane na bieżąco, liczba na końcu
+    if(stream){
+        SeqStream SA, SB;
+        if(!SA.open_path(pos[0])) SA.open_literal(pos[0]);
+        if(!SB.open_path(pos[1])) SB.open_literal(pos[1]);
+        if(summary){
+            // tylko liczniki: pamięć nie zależy od liczby różnic
+            MutationSummary sum(window);
+            compare_streams(SA, SB, [&](const Mutation &m){ sum.add(m); });
+            sum.write_json(cout, SA.pos, SB.pos);
+            cout << "\n";
+            return 0;
+        }
+        size_t count = 0;
+        cout << "Detected differences:\n";
+        compare_streams(SA, SB, [&](const Mutation &m){
+            cout << " - " << describe(m) << "\n";
+            count++;
+        });
+        if(count == 0) cout << " - No differences found. Sequences are identical.\n";
+        cout << "Total differences: " << count << "\n";
+        return 0;
+    }
+
     // Próba wczytania danych jako plików
-    string A = load_text(argv[1]);
-    string B = load_text(argv[2]);
+    Reference ref;
+    string &A = ref.seq;
+    A = load_text(pos[0]);
+    string B = load_text(pos[1]);
 
     // Jeśli load_text zwrócił puste (brak pliku), traktujemy argumenty jako surowe DNA
-    if(A.empty()){ A = argv[1]; for(char &c : A) c = toupper(c); }
-    if(B.empty()){ B = argv[2]; for(char &c : B) c = toupper(c); }
+    if(A.empty() && pos[0] != "-"){ A = pos[0]; for(char &c : A) c = toupper(c); }
+    if(B.empty() && pos[1] != "-"){ B = pos[1]; for(char &c : B) c = toupper(c); }
+
+    // Wykonanie porównania (długie sekwencje dzielone kotwicami i porównywane równolegle)
+    if(summary){
+        // liczniki zbierane w locie, bez listy różnic
+        MutationSummary sum(window);
+        compare_seqs_each(ref, B, threads, [&](const Mutation &m){ sum.add(m); });
+        sum.write_json(cout, A.size(), B.size());
+        cout << "\n";
+        return 0;
+    }
 
-    // Wykonanie porównania
-    auto diffs = compare_seqs(A, B);
+    auto diffs = compare_seqs_parallel(ref, B, threads);
 
     // Prezentacja wyników
     cout << "Detected differences (" << diffs.size() << "):\n";
@@ -135,9 +1624,8 @@ int main(int argc, char **argv){
         cout << " - No differences found. Sequences are identical.\n";
     } else {
         for(const auto &d : diffs)
-            cout << " - " << d << "\n";
+            cout << " - " << describe(d) << "\n";
     }
 
     return 0;
 }
-
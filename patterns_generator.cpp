@@ -9,37 +9,7 @@
 #include <bits/stdc++.h>
 using namespace std;
 
-/**
- * @brief Parsuje plik w formacie FASTA do pojedynczego ciągu znaków
- * Funkcja ignoruje nagłówki (linie zaczynające się od '>') oraz wszelkie białe znaki,
- * normalizując sekwencję do wielkich liter.
- * * @param path Ścieżka do pliku wejściowego .fasta lub .fa
- * @return string Połączona sekwencja nukleotydowa
- */
-string load_fasta(const string &path){
-    ifstream in(path);
-    if(!in){
-        cerr << "Cannot open " << path << "\n";
-        exit(1);
-    }
-    string line, acc, result;
-    while(getline(in, line)){
-        if(!line.empty() && line[0] == '>'){
-            // Obsługa wielu rekordów w jednym pliku FASTA
-            if(!acc.empty()){
-                result += acc;
-                acc.clear();
-            }
-        } else {
-            // Czyszczenie linii z białych znaków i dodawanie do akumulatora
-            for(char c: line)
-                if(!isspace((unsigned char)c))
-                    acc.push_back(toupper(c));
-        }
-    }
-    if(!acc.empty()) result += acc;
-    return result;
-}
+#include "fasta_io.h"
 
 /**
  * @brief Losowo wprowadza znaki maskowania (dziury) do wzorca
@@ -0,0 +1,288 @@
+/**
+ * @file suffix_array.cpp
+ * @author Maria Ławniczak (Nr Indeksu: 268544)
+ * @brief Budowa tablicy sufiksowej (SA-IS, czas liniowy) i tablicy LCP dla referencji DNA
+ * Wynik zapisywany jest w zwartym formacie do mapowania w pamięci (SA + LCP)
+ * i może być użyty przez fm_index (opcja --sa).
+ * SA-IS działa w jednym wątku; --threads dzieli tylko liczenie LCP. --2bit pakuje
+ * sam tekst (n/4 bajtów zamiast n), SA i tablice robocze SA-IS zajmują tyle samo.
+ * @date 2026-01-25
+ */
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#include "fasta_io.h"
+
+/**
+ * @brief Kod symbolu: A C G T = 1..4, N = 5, pozostałe = 6
+ * Ten sam porządek co w fm_index.cpp, więc tablicę można tam użyć bezpośrednio
+ */
+static inline uint8_t sa_code(char c){
+    switch(c){
+        case 'A': return 1;
+        case 'C': return 2;
+        case 'G': return 3;
+        case 'T': return 4;
+        case 'N': return 5;
+        default: return 6;
+    }
+}
+
+/** @brief Tekst jako kody bajtowe (dowolny alfabet) */
+struct ByteText {
+    const vector<uint8_t> &c;
+    int operator[](int i) const { return c[i]; }
+};
+
+/** @brief Tekst upakowany po 2 bity na zasadę (tylko ACGT) - 4x mniej pamięci na tekst (nie na SA) */
+struct PackedText {
+    const vector<uint64_t> &w;
+    int operator[](int i) const { return ((w[i >> 5] >> ((i & 31) * 2)) & 3) + 1; }
+};
+
+/**
+ * @brief SA-IS (Nong, Zhang, Chan): sortowanie sufiksów przez indukcję z sufiksów LMS
+ * s[i] w zakresie [0, upper]; koniec tekstu traktujemy jak unikalny najmniejszy symbol.
+ * Rekurencja działa na nazwach podciągów LMS (vector<int>).
+ */
+template<class S>
+vector<int> sa_is(const S &s, int n, int upper){
+    if(n == 0) return {};
+    if(n == 1) return {0};
+    if(n == 2) return s[0] < s[1] ? vector<int>{0, 1} : vector<int>{1, 0};
+
+    vector<int> sa(n);
+    vector<bool> ls(n, false); // true = typ S
+    for(int i=n-2; i>=0; i--)
+        ls[i] = (s[i] == s[i+1]) ? ls[i+1] : (s[i] < s[i+1]);
+
+    // początki kubełków: sum_l - dla typu L, sum_s - dla typu S
+    vector<int> sum_l(upper + 1), sum_s(upper + 1);
+    for(int i=0; i<n; i++){
+        if(!ls[i]) sum_s[s[i]]++;
+        else sum_l[s[i] + 1]++;
+    }
+    for(int i=0; i<=upper; i++){
+        sum_s[i] += sum_l[i];
+        if(i < upper) sum_l[i+1] += sum_s[i];
+    }
+
+    auto induce = [&](const vector<int> &lms){
+        fill(sa.begin(), sa.end(), -1);
+        vector<int> buf(sum_s);
+        for(int d : lms) if(d != n) sa[buf[s[d]]++] = d;
+        buf = sum_l;
+        sa[buf[s[n-1]]++] = n - 1;
+        for(int i=0; i<n; i++){
+            int v = sa[i];
+            if(v >= 1 && !ls[v-1]) sa[buf[s[v-1]]++] = v - 1;
+        }
+        buf = sum_l;
+        for(int i=n-1; i>=0; i--){
+            int v = sa[i];
+            if(v >= 1 && ls[v-1]) sa[--buf[s[v-1] + 1]] = v - 1;
+        }
+    };
+
+    vector<int> lms_map(n + 1, -1), lms;
+    int m = 0;
+    for(int i=1; i<n; i++) if(!ls[i-1] && ls[i]) lms_map[i] = m++;
+    lms.reserve(m);
+    for(int i=1; i<n; i++) if(!ls[i-1] && ls[i]) lms.push_back(i);
+
+    induce(lms);
+
+    if(m){
+        // nazywanie podciągów LMS w kolejności posortowanej
+        vector<int> sorted_lms;
+        sorted_lms.reserve(m);
+        for(int v : sa) if(lms_map[v] != -1) sorted_lms.push_back(v);
+        vector<int> rec_s(m);
+        int rec_upper = 0;
+        rec_s[lms_map[sorted_lms[0]]] = 0;
+        for(int i=1; i<m; i++){
+            int l = sorted_lms[i-1], r = sorted_lms[i];
+            int end_l = (lms_map[l] + 1 < m) ? lms[lms_map[l] + 1] : n;
+            int end_r = (lms_map[r] + 1 < m) ? lms[lms_map[r] + 1] : n;
+            bool same = true;
+            if(end_l - l != end_r - r) same = false;
+            else {
+                while(l < end_l && s[l] == s[r]){ l++; r++; }
+                if(l == n || s[l] != s[r]) same = false;
+            }
+            if(!same) rec_upper++;
+            rec_s[lms_map[sorted_lms[i]]] = rec_upper;
+        }
+        lms_map = vector<int>(); // zwalniamy przed rekurencją
+
+        vector<int> rec_sa = sa_is(rec_s, m, rec_upper);
+        for(int i=0; i<m; i++) sorted_lms[i] = lms[rec_sa[i]];
+        induce(sorted_lms);
+    }
+    return sa;
+}
+
+/**
+ * @brief Tablica LCP algorytmem Φ (Kärkkäinen, Manzini, Puglisi)
+ * PLCP liczona jest w przedziałach pozycji tekstu niezależnie w wątkach - każdy przedział
+ * zaczyna od h = 0, co zmienia tylko stałą, nie wynik. LCP[i] = lcp(SA[i-1], SA[i]), LCP[0] = 0.
+ */
+template<class S>
+vector<uint32_t> build_lcp(const S &s, int n, const vector<int> &sa, int threads){
+    vector<uint32_t> plcp(n);
+    if(n == 0) return plcp;
+    // Φ[SA[i]] = SA[i-1]; dla najmniejszego sufiksu brak poprzednika
+    plcp[sa[0]] = UINT32_MAX;
+    for(int i=1; i<n; i++) plcp[sa[i]] = sa[i-1];
+
+    auto run = [&](int t, int parts, auto &&body){
+        int64_t b = (int64_t)n * t / parts, e = (int64_t)n * (t + 1) / parts;
+        body((int)b, (int)e);
+    };
+    auto parallel = [&](auto &&body){
+        int parts = max(1, threads);
+        vector<thread> pool;
+        for(int t=1; t<parts; t++) pool.emplace_back([&, t]{ run(t, parts, body); });
+        run(0, parts, body);
+        for(auto &th : pool) th.join();
+    };
+
+    parallel([&](int b, int e){
+        int h = 0;
+        for(int i=b; i<e; i++){
+            uint32_t j = plcp[i];
+            if(j == UINT32_MAX){ plcp[i] = 0; h = 0; continue; }
+            while(i + h < n && (int)j + h < n && s[i+h] == s[j+h]) h++;
+            plcp[i] = h;
+            if(h > 0) h--;
+        }
+    });
+
+    vector<uint32_t> lcp(n);
+    parallel([&](int b, int e){
+        for(int i=b; i<e; i++) lcp[i] = plcp[sa[i]];
+    });
+    return lcp;
+}
+
+/**
+ * @brief Nagłówek pliku tablicy sufiksowej; sekcje wyrównane do 64 bajtów
+ * SA: uint32[n]. LCP: uint8[n], gdzie 255 oznacza wartość w tablicy nadmiarów
+ * (pary uint32 indeks, wartość posortowane po indeksie).
+ */
+struct SaHeader {
+    char magic[8];          // "ACSAIDX1"
+    uint64_t n;             // długość tekstu
+    uint64_t flags;         // bit 0: jest LCP, bit 1: budowane na tekście 2-bitowym, bit 2: N osobno od innych znaków
+    uint64_t off_sa;
+    uint64_t off_lcp;
+    uint64_t off_lcp_over;
+    uint64_t n_lcp_over;
+    uint64_t reserved;
+};
+
+/** @brief Dopełnienie pliku zerami do wielokrotności 64 bajtów */
+static uint64_t pad64(ofstream &out, uint64_t pos){
+    static const char zeros[64] = {};
+    uint64_t aligned = (pos + 63) & ~uint64_t(63);
+    out.write(zeros, aligned - pos);
+    return aligned;
+}
+
+int main(int argc, char **argv){
+    vector<string> pos;
+    bool want_lcp = false, packed = false;
+    int threads = max(1u, thread::hardware_concurrency());
+    for(int a=1; a<argc; a++){
+        string arg = argv[a];
+        if(arg == "--lcp") want_lcp = true;
+        else if(arg == "--2bit") packed = true;
+        else if(arg == "--threads" && a+1 < argc) threads = stoi(argv[++a]);
+        else pos.push_back(arg);
+    }
+    if(pos.size() < 2){
+        cerr << "Usage: " << argv[0] << " <fasta> <out.sa> [--lcp] [--2bit] [--threads N]\n"
+             << "  --2bit      pack the text 2 bits per base (ACGT only); SA memory is unchanged\n"
+             << "  --threads N threads for the LCP pass; SA-IS itself is sequential\n";
+        return 1;
+    }
+
+    auto t0 = chrono::high_resolution_clock::now();
+    string text = load_fasta(pos[0]);
+    if(text.size() >= (size_t)INT32_MAX){
+        cerr << "Text too long for 32-bit suffix array: " << text.size() << "\n";
+        return 1;
+    }
+    int n = text.size();
+
+    // Wariant 2-bitowy wymaga czystego ACGT; w przeciwnym razie wracamy do kodów bajtowych
+    if(packed && text.find_first_not_of("ACGT") != string::npos){
+        cerr << "Warning: text contains non-ACGT symbols, using byte text\n";
+        packed = false;
+    }
+
+    vector<int> sa;
+    vector<uint32_t> lcp;
+    if(packed){
+        vector<uint64_t> words((n + 31) / 32, 0);
+        for(int i=0; i<n; i++) words[i >> 5] |= uint64_t(sa_code(text[i]) - 1) << ((i & 31) * 2);
+        string().swap(text);
+        PackedText s{words};
+        sa = sa_is(s, n, 4);
+        if(want_lcp) lcp = build_lcp(s, n, sa, threads);
+    } else {
+        vector<uint8_t> codes(n);
+        for(int i=0; i<n; i++) codes[i] = sa_code(text[i]);
+        string().swap(text);
+        ByteText s{codes};
+        sa = sa_is(s, n, 6);
+        if(want_lcp) lcp = build_lcp(s, n, sa, threads);
+    }
+    auto t1 = chrono::high_resolution_clock::now();
+
+    SaHeader h{};
+    memcpy(h.magic, "ACSAIDX1", 8);
+    h.n = n;
+    h.flags = (want_lcp ? 1 : 0) | (packed ? 2 : 0) | 4;
+
+    ofstream out(pos[1], ios::binary);
+    if(!out){
+        cerr << "Cannot create suffix array file: " << pos[1] << "\n";
+        return 1;
+    }
+    out.write((const char*)&h, sizeof(h));
+    uint64_t fpos = pad64(out, sizeof(h));
+
+    h.off_sa = fpos;
+    static_assert(sizeof(int) == sizeof(uint32_t), "SA stored as uint32");
+    out.write((const char*)sa.data(), (uint64_t)n * 4);
+    fpos = pad64(out, fpos + (uint64_t)n * 4);
+
+    if(want_lcp){
+        vector<uint8_t> small(n);
+        vector<uint32_t> over;
+        for(int i=0; i<n; i++){
+            if(lcp[i] < 255) small[i] = lcp[i];
+            else { small[i] = 255; over.push_back(i); over.push_back(lcp[i]); }
+        }
+        h.off_lcp = fpos;
+        out.write((const char*)small.data(), n);
+        fpos = pad64(out, fpos + n);
+        h.off_lcp_over = fpos;
+        h.n_lcp_over = over.size() / 2;
+        out.write((const char*)over.data(), over.size() * 4);
+        fpos = pad64(out, fpos + over.size() * 4);
+    }
+
+    out.seekp(0);
+    out.write((const char*)&h, sizeof(h));
+    out.close();
+
+    auto t2 = chrono::high_resolution_clock::now();
+    cerr << "[OK] Saved " << pos[1] << " (Text: " << n << (packed ? ", 2-bit" : "")
+         << (want_lcp ? ", LCP overflow: " + to_string(h.n_lcp_over) : string()) << ", Size: " << fpos << " B)\n"
+         << "SA" << (want_lcp ? "+LCP" : "") << " time: " << chrono::duration<double>(t1 - t0).count() << " s, "
+         << "Total time: " << chrono::duration<double>(t2 - t0).count() << " s\n";
+    return 0;
+}
@@ -0,0 +1,138 @@
+#!/bin/sh
+# Testy regresyjne narzędzi (make check): małe dane wejściowe w tym katalogu
+# i oczekiwany fragment wyniku. Uruchamiane z katalogu głównego projektu.
+
+T=tests
+failed=0
+
+# check <nazwa> <oczekiwany fragment> <polecenie...> - polecenie musi wypisać fragment na stdout
+check(){
+    name=$1; want=$2; shift 2
+    out=$("$@" 2>/dev/null)
+    if printf '%s\n' "$out" | grep -qF -- "$want"; then
+        echo "PASS $name"
+    else
+        echo "FAIL $name: expected '$want'"
+        printf '%s\n' "$out" | sed 's/^/    /'
+        failed=1
+    fi
+}
+
+W=$(mktemp -d)
+trap 'rm -rf "$W"' EXIT
+
+# Sekwencje od 64 kb (próg dzielenia kotwicami) generujemy tutaj deterministycznym
+# LCG (MINSTD): $W/tail.txt to losowe 70 kb, $W/pa.fa / $W/pb.fa to para 90 kb
+# i $W/qa.fa / $W/qb.fa para 20 kb, gdzie B ma SNP co 997 zasad, delecję co 3001
+# i insercję co 4999 zasad
+awk -v W="$W" 'function pair(len, fa, fb,    i, c, a, b){
+        for(i = 0; i < len; i++){
+            x = (x * 16807) % 2147483647; c = substr("ACGT", x % 4 + 1, 1); a = a c
+            if(i % 4999 == 100) b = b "T"
+            if(i % 3001 == 50) continue
+            if(i % 997 == 10) c = (c == "A") ? "C" : "A"
+            b = b c
+        }
+        print ">a" > (W "/" fa); print a > (W "/" fa)
+        print ">b" > (W "/" fb); print b > (W "/" fb)
+    }
+    BEGIN{ x = 12345
+    for(i = 0; i < 70000; i++){ x = (x * 16807) % 2147483647; t = t substr("ACGT", x % 4 + 1, 1) }
+    print t > (W "/tail.txt")
+    pair(90000, "pa.fa", "pb.fa")
+    pair(20000, "qa.fa", "qb.fa") }'
+
+# Parser FASTA: CRLF, małe litery, białe znaki w linii, puste linie, '>' w opisie,
+# ostatnia linia bez znaku nowej linii; plik i stdin dają ten sam tekst
+check fasta_parser_length "FASTA length: 135" \
+    ./aho_gapped $T/parser.fa $T/parser_patterns.txt
+check fasta_parser_matches "Total matches: 3" \
+    ./aho_gapped $T/parser.fa $T/parser_patterns.txt
+check fasta_parser_stdin "Total matches: 3" \
+    sh -c "./aho_gapped - $T/parser_patterns.txt < $T/parser.fa"
+
+# Wariant przy początku rekordu chr2: flanki sond nie mogą sięgać do chr1
+check contig_edge_variant "$(printf 'chr2\t5\tv1\tC\tG\t0\t1\t1/1')" \
+    ./genotype $T/edge_ref.fa $T/edge.vcf $T/edge_sample.fa
+
+# Seed głosujący w klasyfikacji musi być wolny od N (pierwszy odcinek wzorca zawiera N)
+check classify_n_seed "$(printf 'r1\t0\t34\tlab1\t2\t2')" \
+    ./aho_gapped $T/classify_reads.fa $T/classify_patterns.txt --classify /dev/stdout
+
+# Domyślna liczba trafień bez filtra seedów jest taka jak w pierwotnym narzędziu
+check total_matches "Total matches: 4" \
+    ./aho_gapped $T/total_text.fa $T/total_patterns.txt
+
+# Duplikacja, której źródło leży przed segmentem między kotwicami (wspólny ogon
+# wydłuża parę ponad próg dzielenia kotwicami)
+cat $T/dup_ref.fa $W/tail.txt > $W/dup_ref.fa
+cat $T/dup_sample.fa $W/tail.txt > $W/dup_sample.fa
+check anchored_tandem_dup "Tandem duplication at pos 2848: duplicated 200 bp" \
+    ./mutations $W/dup_ref.fa $W/dup_sample.fa
+
+# Indeks FM z własnej tablicy sufiksowej i z pliku suffix_array jest identyczny,
+# a wyszukiwanie przez indeks daje te same trafienia co skan (N pasuje tylko do N)
+check fm_sa_round_trip "same" sh -c "./suffix_array $T/fmsa.fa $W/t.sa && ./fm_index $T/fmsa.fa $W/a.fmi \
+    && ./fm_index $T/fmsa.fa $W/b.fmi --sa $W/t.sa && cmp -s $W/a.fmi $W/b.fmi && echo same"
+check fm_index_vs_scan "same" sh -c "./aho_gapped $T/fmsa.fa $T/fmsa_patterns.txt --engine scan --hits $W/s.tsv \
+    && ./aho_gapped $T/fmsa.fa $T/fmsa_patterns.txt --index $W/a.fmi --engine index --hits $W/i.tsv \
+    && cmp -s $W/s.tsv $W/i.tsv && echo same"
+# Indeks zbudowany z innego pliku FASTA i --engine index bez indeksu są odrzucane
+check fm_index_other_fasta "does not match index" sh -c "./aho_gapped $T/seedf.fa $T/fmsa_patterns.txt --index $W/a.fmi 2>&1"
+check fm_engine_needs_index "needs --index" sh -c "./aho_gapped $T/fmsa.fa $T/fmsa_patterns.txt --engine index 2>&1"
+
+# --seed-filter tylko przyspiesza: plik trafień taki sam jak bez filtra (także dla seeda z N)
+check seed_filter_same_hits "same" sh -c "./aho_gapped $T/seedf.fa $T/seedf_patterns.txt --hits $W/d.tsv \
+    && ./aho_gapped $T/seedf.fa $T/seedf_patterns.txt --seed-filter --hits $W/f.tsv \
+    && cmp -s $W/d.tsv $W/f.tsv && echo same"
+
+# Para dzielona kotwicami: wynik nie zależy od liczby wątków
+check threads_same_diff "same" sh -c "./mutations $W/pa.fa $W/pb.fa --threads 1 > $W/t1.txt \
+    && ./mutations $W/pa.fa $W/pb.fa --threads 4 > $W/t4.txt \
+    && grep -q 'SNP' $W/t1.txt && cmp -s $W/t1.txt $W/t4.txt && echo same"
+
+# mutations --stream daje te same różnice co jeden przebieg w pamięci (para poniżej 64 kb)
+check stream_same_diff "same" sh -c "./mutations $W/qa.fa $W/qb.fa | sed 1d > $W/m.txt \
+    && ./mutations $W/qa.fa $W/qb.fa --stream | sed '1d;\$d' > $W/s.txt \
+    && test -s $W/m.txt && cmp -s $W/m.txt $W/s.txt && echo same"
+
+# aho_gapped: skan strumieniowy stdin podawanego w trzech porcjach po 30000 bajtów daje
+# te same trafienia (z flankami, dla dwóch paneli) i tę samą liczbę dopasowań co skan
+# w pamięci; dwa dodatkowe wzorce (jeden z luką) przecinają granice porcji
+./patterns_generator $W/pa.fa $W/gp 0.2 2>/dev/null
+awk 'NR == 2 { print substr($0, 29985, 25); p = substr($0, 59980, 30); print substr(p, 1, 10) "." substr(p, 12) }' \
+    $W/pa.fa >> $W/gp_200.txt
+check stream_same_hits "same" sh -c "./aho_gapped $W/pa.fa $W/gp_200.txt --panel $W/gp_50.txt,3,$W/s50.tsv --engine scan \
+        --context 5 --hits $W/s200.tsv | grep Total > $W/st.txt \
+    && { head -c 30000 $W/pa.fa; sleep 0.2; tail -c +30001 $W/pa.fa | head -c 30000; sleep 0.2; tail -c +60001 $W/pa.fa; } \
+        | ./aho_gapped - $W/gp_200.txt --panel $W/gp_50.txt,3,$W/t50.tsv --context 5 --hits $W/t200.tsv \
+        | grep Total > $W/tt.txt \
+    && cmp -s $W/st.txt $W/tt.txt && cmp -s $W/s200.tsv $W/t200.tsv && cmp -s $W/s50.tsv $W/t50.tsv && echo same"
+
+# Indele w homopolimerach przesunięte do skrajnie lewej pozycji (w pamięci i --stream)
+check indel_left_norm "Deletion at pos 4: removed A; - Deletion at pos 17: removed T;" \
+    sh -c "./mutations GGCTAAAAAGTCCAGGCTTTTGA GGCTAAAAGTCCAGGCTTTGA | tr '\n' ';'"
+check indel_left_norm_stream "Deletion at pos 4: removed A; - Deletion at pos 17: removed T;" \
+    sh -c "./mutations GGCTAAAAAGTCCAGGCTTTTGA GGCTAAAAGTCCAGGCTTTGA --stream | tr '\n' ';'"
+check indel_left_norm_ins "Insertion at pos 4: inserted A" \
+    ./mutations GGCTAAAAAGTCCA GGCTAAAAAAGTCCA
+
+# Punkt kontrolny: skan przerwany (kill -9) po zapisie pierwszego punktu kontrolnego
+# i wznowiony daje ten sam plik trafień i te same liczniki co skan bez przerwy.
+# Punkt kontrolny powstaje po każdej porcji 16 MB, więc wejście ma ich trzy (36 MB);
+# ostatni wzorzec przecina granicę pierwszej porcji (bajt 16777216 pliku to znak 37027 linii).
+awk 'NR == 1; NR == 2 { for(i = 0; i < 400; i++) print $0 }' $W/pa.fa > $W/ck.fa
+awk 'NR == 2 { print substr($0, 1001, 24); print substr($0, 30001, 30)
+    p = substr($0, 60001, 30); print substr(p, 1, 14) "." substr(p, 16)
+    print substr($0, 37011, 30) }' $W/pa.fa > $W/ck_patterns.txt
+./aho_gapped $W/ck.fa $W/ck_patterns.txt --engine stream --hits $W/c1.tsv 2>/dev/null | grep -e length -e Total > $W/c1.txt
+./aho_gapped $W/ck.fa $W/ck_patterns.txt --checkpoint $W/ck.ckpt --hits $W/c2.tsv > /dev/null 2>&1 &
+pid=$!
+while kill -0 $pid 2>/dev/null && [ ! -f $W/ck.ckpt ]; do sleep 0.01; done
+kill -9 $pid 2>/dev/null
+wait $pid 2>/dev/null
+check checkpoint_resume "same" sh -c "./aho_gapped $W/ck.fa $W/ck_patterns.txt --checkpoint $W/ck.ckpt --hits $W/c2.tsv 2>/dev/null \
+        | grep -e length -e Total > $W/c2.txt \
+    && test -s $W/c1.tsv && cmp -s $W/c1.txt $W/c2.txt && cmp -s $W/c1.tsv $W/c2.tsv && test ! -f $W/ck.ckpt && echo same"
+
+exit $failed